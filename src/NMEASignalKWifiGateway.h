@@ -12,6 +12,9 @@
 #include <N2kTypes.h>
 #include <NMEA2000.h>
 
+#include <atomic>
+
+#include "halmet_n2k_rx_task.h"
 #include "sensesp/net/discovery.h"
 #include "sensesp/net/networking.h"
 #include "sensesp/ui/config_item.h"
@@ -22,20 +25,22 @@ namespace halmet {
 
 class NMEASignalKWifiGateway : public sensesp::FileSystemSaveable {
  public:
-  NMEASignalKWifiGateway(String config_path, tNMEA2000* nmea2000, String skHost,
+  NMEASignalKWifiGateway(String config_path, tNMEA2000* nmea2000,
+                         N2kRxTask* rx_task, String skHost,
                          bool enabled = false)
       : sensesp::FileSystemSaveable{config_path}, enabled{enabled} {
-    char skHost_[100];
-    skHost.toCharArray(skHost_, 100);
     this->load();
 
     if (this->enabled) {
-      nmea2000->AttachMsgHandler(
-          new MyMessageHandler(nmea2000, skHost_, &nodeAddress));
+      nmea2000->AttachMsgHandler(new MyMessageHandler(
+          nmea2000, rx_task, skHost, &nodeAddress, &dropped_));
     }
   }
   virtual ~NMEASignalKWifiGateway() { this->save(); }
 
+  /// Number of messages that could not be forwarded or sent over UDP
+  unsigned long get_dropped() const { return dropped_; }
+
   virtual bool from_json(const JsonObject& config) override {
     if (!config["enabled"].is<bool>())
       return false;
@@ -59,20 +64,36 @@ class NMEASignalKWifiGateway : public sensesp::FileSystemSaveable {
  protected:
   class MyMessageHandler : public tNMEA2000::tMsgHandler {
    public:
-    MyMessageHandler(tNMEA2000* _pNMEA2000, char* _skHost, int* _nodeAddress)
+    MyMessageHandler(tNMEA2000* _pNMEA2000, N2kRxTask* _rxTask,
+                     String _skHost, int* _nodeAddress,
+                     std::atomic<unsigned long>* _dropped)
         : tNMEA2000::tMsgHandler(0, _pNMEA2000),
+          rxTask{_rxTask},
           skHost{_skHost},
-          nodeAddress{_nodeAddress} {}
+          nodeAddress{_nodeAddress},
+          dropped{_dropped} {}
 
    protected:
-    char* skHost;
+    N2kRxTask* rxTask;
+    // Own copy: messages are sent long after the constructor returned
+    String skHost;
     int* nodeAddress;
+    std::atomic<unsigned long>* dropped;
     uint16_t DaysSince1970 = 0;
     double SecondsSinceMidnight = 0;
 
+    // Runs in the N2K RX task with the bus lock held. Only note the source
+    // address here; the formatting and the UDP send happen on the event
+    // loop, where a Wi-Fi stall can't hold up the senders.
     void HandleMsg(const tN2kMsg& N2kMsg) override {
       CheckSourceAddressChange();
 
+      if (!rxTask->post([this, N2kMsg]() { this->Forward(N2kMsg); })) {
+        (*this->dropped)++;
+      }
+    }
+
+    void Forward(const tN2kMsg& N2kMsg) {
       WiFiUDP udp;
       const int udpPort = 4444;  // YD UDP port
 
@@ -85,9 +106,11 @@ class NMEASignalKWifiGateway : public sensesp::FileSystemSaveable {
 
       N2kToYD_Can(N2kMsg, YD_msg);  // Create YD message from PGN
 
-      udp.beginPacket(this->skHost, udpPort);  // Send to UDP
+      udp.beginPacket(this->skHost.c_str(), udpPort);  // Send to UDP
       udp.println(YD_msg);
-      udp.endPacket();
+      if (!udp.endPacket()) {
+        (*this->dropped)++;
+      }
     }
 
     void CheckSourceAddressChange() {
@@ -181,6 +204,7 @@ class NMEASignalKWifiGateway : public sensesp::FileSystemSaveable {
 
   bool enabled;
   int nodeAddress;
+  std::atomic<unsigned long> dropped_{0};
 };
 
 const String ConfigSchema(const NMEASignalKWifiGateway& obj) {
@@ -0,0 +1,184 @@
+#ifndef HALMET_SRC_COMPILED_CURVE_H_
+#define HALMET_SRC_COMPILED_CURVE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace halmet {
+
+/**
+ * @brief Piecewise curve compiled for constant-time evaluation.
+ *
+ * Each segment between two calibration points is stored as a polynomial in
+ * the distance from its left end: linear for piecewise linear
+ * interpolation, cubic Hermite for monotonic cubic interpolation
+ * (Fritsch-Carlson), which never overshoots between points of a monotonic
+ * curve.
+ *
+ * A uniform grid over the input range maps each input to its grid cell in
+ * one multiplication. Each cell stores the range of segments that overlap
+ * it, and a binary search within that range finds the segment. The grid is
+ * sized so that cells are no wider than the narrowest segment (up to
+ * kMaxBuckets cells), so most cells overlap only one or two segments and the
+ * search is a step or two regardless of how unevenly the points are spaced.
+ * Inputs outside the calibrated range are clamped to the end values.
+ */
+class CompiledCurve {
+ public:
+  enum class Interpolation { kLinear, kMonotonicCubic };
+
+  /// Grid size limit for curves with very narrow segments
+  static const size_t kMaxBuckets = 1024;
+
+  /**
+   * @brief Compile a curve from points sorted by strictly increasing input.
+   *
+   * Allocates; call when the calibration changes, not per sample.
+   */
+  void compile(const std::vector<float>& inputs,
+               const std::vector<float>& outputs,
+               Interpolation interpolation) {
+    size_t n = std::min(inputs.size(), outputs.size());
+    xs_.assign(inputs.begin(), inputs.begin() + n);
+    segments_.clear();
+    buckets_.clear();
+    if (n == 0) {
+      return;
+    }
+    y_last_ = outputs[n - 1];
+    if (n == 1) {
+      segments_.push_back({outputs[0], 0, 0, 0});
+      return;
+    }
+
+    size_t num_segments = n - 1;
+    std::vector<float> slopes(num_segments);
+    for (size_t k = 0; k < num_segments; k++) {
+      slopes[k] = (outputs[k + 1] - outputs[k]) / (xs_[k + 1] - xs_[k]);
+    }
+
+    // Tangents at the points; only used for cubic segments
+    std::vector<float> tangents(n);
+    if (interpolation == Interpolation::kMonotonicCubic) {
+      monotonic_tangents(slopes, tangents);
+    }
+
+    segments_.resize(num_segments);
+    for (size_t k = 0; k < num_segments; k++) {
+      Segment& s = segments_[k];
+      s.c0 = outputs[k];
+      if (interpolation == Interpolation::kLinear) {
+        s.c1 = slopes[k];
+        s.c2 = s.c3 = 0;
+      } else {
+        float h = xs_[k + 1] - xs_[k];
+        s.c1 = tangents[k];
+        s.c2 = (3 * slopes[k] - 2 * tangents[k] - tangents[k + 1]) / h;
+        s.c3 = (tangents[k] + tangents[k + 1] - 2 * slopes[k]) / (h * h);
+      }
+    }
+
+    // At least four cells per segment, and enough for cells to be no wider
+    // than the narrowest segment.
+    float min_width = xs_[1] - xs_[0];
+    for (size_t k = 1; k < num_segments; k++) {
+      min_width = std::min(min_width, xs_[k + 1] - xs_[k]);
+    }
+    float range = xs_.back() - xs_.front();
+    size_t num_buckets = std::max(
+        4 * num_segments,
+        (size_t)std::min(ceilf(range / min_width), (float)kMaxBuckets));
+    x_min_ = xs_.front();
+    inv_bucket_width_ = num_buckets / range;
+    // buckets_[b] is the segment containing the start of cell b, so cell b
+    // overlaps segments buckets_[b] to buckets_[b + 1].
+    buckets_.resize(num_buckets + 1);
+    size_t k = 0;
+    for (size_t b = 0; b <= num_buckets; b++) {
+      float bucket_start = x_min_ + b / inv_bucket_width_;
+      while (k + 1 < num_segments && xs_[k + 1] <= bucket_start) {
+        k++;
+      }
+      buckets_[b] = (uint16_t)k;
+    }
+  }
+
+  bool empty() const { return segments_.empty(); }
+
+  float evaluate(float x) const {
+    if (segments_.empty()) {
+      return NAN;
+    }
+    if (buckets_.empty()) {
+      // Single point
+      return segments_[0].c0;
+    }
+    if (!(x > xs_.front())) {
+      return segments_.front().c0;
+    }
+    if (x >= xs_.back()) {
+      return y_last_;
+    }
+
+    size_t b = std::min((size_t)((x - x_min_) * inv_bucket_width_),
+                        buckets_.size() - 2);
+    // Widen the range by one segment on each side: rounding can put x just
+    // outside the cell it was mapped to.
+    size_t first = buckets_[b] > 0 ? buckets_[b] - 1 : 0;
+    size_t last = std::min((size_t)buckets_[b + 1] + 1, segments_.size() - 1);
+    // Segment k starts at xs_[k]: find the last start at or below x
+    size_t k = std::upper_bound(xs_.begin() + first + 1,
+                                xs_.begin() + last + 1, x) -
+               xs_.begin() - 1;
+    const Segment& s = segments_[k];
+    float dx = x - xs_[k];
+    return s.c0 + dx * (s.c1 + dx * (s.c2 + dx * s.c3));
+  }
+
+ protected:
+  struct Segment {
+    float c0, c1, c2, c3;
+  };
+
+  // Fritsch-Carlson tangents: zero at local extrema, limited elsewhere so
+  // that each segment stays monotonic.
+  static void monotonic_tangents(const std::vector<float>& slopes,
+                                 std::vector<float>& tangents) {
+    size_t n = tangents.size();
+    tangents[0] = slopes[0];
+    tangents[n - 1] = slopes[n - 2];
+    for (size_t k = 1; k < n - 1; k++) {
+      tangents[k] = slopes[k - 1] * slopes[k] <= 0
+                        ? 0
+                        : (slopes[k - 1] + slopes[k]) / 2;
+    }
+    for (size_t k = 0; k < n - 1; k++) {
+      if (slopes[k] == 0) {
+        tangents[k] = tangents[k + 1] = 0;
+        continue;
+      }
+      float alpha = tangents[k] / slopes[k];
+      float beta = tangents[k + 1] / slopes[k];
+      float norm = alpha * alpha + beta * beta;
+      if (norm > 9) {
+        float tau = 3 / sqrtf(norm);
+        tangents[k] = tau * alpha * slopes[k];
+        tangents[k + 1] = tau * beta * slopes[k];
+      }
+    }
+  }
+
+  std::vector<float> xs_;
+  std::vector<Segment> segments_;
+  std::vector<uint16_t> buckets_;
+  float x_min_ = 0;
+  float inv_bucket_width_ = 0;
+  float y_last_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_COMPILED_CURVE_H_
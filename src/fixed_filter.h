@@ -0,0 +1,180 @@
+#ifndef HALMET_SRC_FIXED_FILTER_H_
+#define HALMET_SRC_FIXED_FILTER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace halmet {
+
+// Fractional bits of the filter sample values. Q8 covers +-8 Mohm at
+// 1/256 ohm resolution, plenty for resistive senders.
+const int kFixedFilterValueBits = 8;
+
+inline int32_t FloatToFixedSample(float value) {
+  return (int32_t)lroundf(value * (1 << kFixedFilterValueBits));
+}
+
+inline float FixedSampleToFloat(int32_t value) {
+  return (float)value / (1 << kFixedFilterValueBits);
+}
+
+/**
+ * @brief Running median over the last N samples.
+ *
+ * Removes isolated spikes without smearing them into the following output
+ * like a mean would. The window lives in a fixed ring buffer; the median is
+ * selected from a copy on the stack.
+ *
+ * @tparam MaxSize Largest supported window
+ */
+template <size_t MaxSize>
+class MedianFilter {
+ public:
+  explicit MedianFilter(size_t size = 1) { set_size(size); }
+
+  /// Set the window length; clamped to [1, MaxSize]. Resets the state.
+  void set_size(size_t size) {
+    size_ = std::min(std::max(size, (size_t)1), MaxSize);
+    reset();
+  }
+
+  size_t get_size() const { return size_; }
+
+  void reset() {
+    count_ = 0;
+    next_ = 0;
+  }
+
+  int32_t update(int32_t value) {
+    window_[next_] = value;
+    next_ = (next_ + 1) % size_;
+    if (count_ < size_) {
+      count_++;
+    }
+
+    int32_t sorted[MaxSize];
+    std::copy(window_, window_ + count_, sorted);
+    int32_t* middle = sorted + count_ / 2;
+    std::nth_element(sorted, middle, sorted + count_);
+    return *middle;
+  }
+
+ protected:
+  int32_t window_[MaxSize];
+  size_t size_;
+  size_t count_;
+  size_t next_;
+};
+
+/**
+ * @brief First-order low-pass (exponential moving average) in fixed point.
+ *
+ * y += alpha * (x - y), with alpha in Q16 and the state kept with 16 extra
+ * fractional bits so that small steps are not lost to truncation at long
+ * time constants.
+ */
+class FixedEmaFilter {
+ public:
+  /**
+   * @param time_constant Filter time constant, in s
+   * @param sample_interval Time between samples, in s
+   */
+  void configure(float time_constant, float sample_interval) {
+    float alpha = time_constant > 0
+                      ? 1.0f - expf(-sample_interval / time_constant)
+                      : 1.0f;
+    alpha_ = std::max((int32_t)lroundf(alpha * (1 << kAlphaBits)), (int32_t)1);
+    reset();
+  }
+
+  void reset() { primed_ = false; }
+
+  int32_t update(int32_t value) {
+    int64_t x = (int64_t)value << kAlphaBits;
+    if (!primed_) {
+      state_ = x;
+      primed_ = true;
+    } else {
+      state_ += ((x - state_) * alpha_) >> kAlphaBits;
+    }
+    return (int32_t)(state_ >> kAlphaBits);
+  }
+
+ protected:
+  static const int kAlphaBits = 16;
+
+  int32_t alpha_ = 1 << kAlphaBits;
+  int64_t state_ = 0;
+  bool primed_ = false;
+};
+
+/**
+ * @brief Second-order Butterworth low-pass in fixed point.
+ *
+ * Direct form I with Q30 coefficients, 64-bit accumulation and first-order
+ * error feedback, which keeps the filter accurate at cutoff frequencies far
+ * below the sample rate. The numerator is adjusted after quantization so
+ * that the DC gain is exactly one: a constant tank level passes through
+ * unchanged.
+ */
+class FixedBiquadLowPass {
+ public:
+  /**
+   * @param cutoff_frequency -3 dB frequency, in Hz
+   * @param sample_rate Sample rate, in Hz
+   */
+  void configure(float cutoff_frequency, float sample_rate) {
+    // Keep the cutoff well inside (0, Nyquist)
+    float fc = std::min(std::max(cutoff_frequency, sample_rate * 1e-5f),
+                        sample_rate * 0.45f);
+    double w0 = 2 * M_PI * fc / sample_rate;
+    double alpha = sin(w0) / (2 * M_SQRT1_2);
+    double a0 = 1 + alpha;
+    double cos_w0 = cos(w0);
+
+    const double scale = (double)(1LL << kCoeffBits);
+    a1_ = (int32_t)llround(-2 * cos_w0 / a0 * scale);
+    a2_ = (int32_t)llround((1 - alpha) / a0 * scale);
+    b0_ = (int32_t)llround((1 - cos_w0) / 2 / a0 * scale);
+    b2_ = b0_;
+    // b0 + b1 + b2 == 1 + a1 + a2 gives unity gain at DC.
+    b1_ = (int32_t)((1LL << kCoeffBits) + a1_ + a2_ - b0_ - b2_);
+    reset();
+  }
+
+  void reset() { primed_ = false; }
+
+  int32_t update(int32_t value) {
+    if (!primed_) {
+      // Start in the steady state for the first input
+      x1_ = x2_ = y1_ = y2_ = value;
+      error_ = 0;
+      primed_ = true;
+      return value;
+    }
+    int64_t acc = (int64_t)b0_ * value + (int64_t)b1_ * x1_ +
+                  (int64_t)b2_ * x2_ - (int64_t)a1_ * y1_ -
+                  (int64_t)a2_ * y2_ + error_;
+    int32_t y = (int32_t)(acc >> kCoeffBits);
+    error_ = acc - ((int64_t)y << kCoeffBits);
+    x2_ = x1_;
+    x1_ = value;
+    y2_ = y1_;
+    y1_ = y;
+    return y;
+  }
+
+ protected:
+  static const int kCoeffBits = 30;
+
+  int32_t b0_ = 1 << kCoeffBits, b1_ = 0, b2_ = 0, a1_ = 0, a2_ = 0;
+  int32_t x1_ = 0, x2_ = 0, y1_ = 0, y2_ = 0;
+  int64_t error_ = 0;
+  bool primed_ = false;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_FIXED_FILTER_H_
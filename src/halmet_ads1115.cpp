@@ -0,0 +1,366 @@
+#include "halmet_ads1115.h"
+
+#include "halmet_profiler.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+// ADS1115 data rates selected by the DR bits of the config register, in
+// samples per second.
+const unsigned int kADS1115DataRates[] = {8, 16, 32, 64, 128, 250, 475, 860};
+
+// Conversions not completed within this many conversion times are
+// abandoned, in case the chip stopped responding.
+const unsigned int kADS1115TimeoutFactor = 4;
+
+const uint16_t kADS1115ChannelMux[] = {
+    ADS1X15_REG_CONFIG_MUX_SINGLE_0, ADS1X15_REG_CONFIG_MUX_SINGLE_1,
+    ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS1X15_REG_CONFIG_MUX_SINGLE_3};
+
+// Fraction of the conversion capacity the sequencer will schedule. The
+// rest absorbs I2C transfer time and event loop latency.
+const float kADS1115MaxUtilization = 0.8;
+
+// PGA settings from the widest to the narrowest input range
+const adsGain_t kADS1115Gains[] = {GAIN_TWOTHIRDS, GAIN_ONE,   GAIN_TWO,
+                                   GAIN_FOUR,      GAIN_EIGHT, GAIN_SIXTEEN};
+const int kADS1115NumGains = sizeof(kADS1115Gains) / sizeof(kADS1115Gains[0]);
+
+// Auto gain: step down when a reading exceeds this fraction of full scale,
+// step up when the window peak would stay below this fraction of the next
+// range. The gap between the two is the hysteresis.
+const float kADS1115GainDownThreshold = 0.95;
+const float kADS1115GainUpThreshold = 0.75;
+// Number of samples the peak must stay low before stepping up
+const int kADS1115GainUpWindow = 8;
+
+float ADS1115FullScaleRange(adsGain_t gain) {
+  switch (gain) {
+    case GAIN_TWOTHIRDS:
+      return 6.144;
+    case GAIN_ONE:
+      return 4.096;
+    case GAIN_TWO:
+      return 2.048;
+    case GAIN_FOUR:
+      return 1.024;
+    case GAIN_EIGHT:
+      return 0.512;
+    case GAIN_SIXTEEN:
+      return 0.256;
+  }
+  return 0;
+}
+
+ADS1115Async::ADS1115Async(Adafruit_ADS1115* ads1115, int ready_pin,
+                           I2CScheduler* i2c, int i2c_client)
+    : ads1115_{ads1115},
+      ready_pin_{ready_pin},
+      i2c_{i2c},
+      i2c_client_{i2c_client} {
+  if (ready_pin_ >= 0) {
+    // startADCReading() configures ALERT/RDY as an active-low conversion
+    // ready output.
+    pinMode(ready_pin_, INPUT_PULLUP);
+    attachInterruptArg(ready_pin_, ready_isr, this, FALLING);
+    OnTick("ADS1115 ready", [this]() {
+      if (busy_ && ready_) {
+        finish();
+      }
+    });
+  }
+}
+
+bool ADS1115Async::read(int channel, adsGain_t gain, Callback callback) {
+  if (channel < 0 || channel > 3) {
+    return false;
+  }
+  if (!queue_.push({channel, gain, std::move(callback)})) {
+    return false;
+  }
+  if (!busy_) {
+    start_next();
+  }
+  return true;
+}
+
+unsigned int ADS1115Async::get_conversion_time() const {
+  unsigned int rate = kADS1115DataRates[(ads1115_->getDataRate() >> 5) & 0x7];
+  // Round up and allow for the internal oscillator running up to 10% slow.
+  return (1100 + rate - 1) / rate;
+}
+
+void IRAM_ATTR ADS1115Async::ready_isr(void* arg) {
+  static_cast<ADS1115Async*>(arg)->ready_ = true;
+}
+
+void ADS1115Async::start_next() {
+  if (!queue_.pop(current_)) {
+    busy_ = false;
+    return;
+  }
+  busy_ = true;
+  ready_ = false;
+  conversion_id_++;
+  start_time_ = millis();
+  start_time_us_ = micros();
+  ads1115_->setGain(current_.gain);
+  i2c_transaction([this]() {
+    ads1115_->startADCReading(kADS1115ChannelMux[current_.channel],
+                              /*continuous=*/false);
+  });
+  // With a ready pin the poll is only a fallback if the interrupt is missed.
+  unsigned int conversion_time = get_conversion_time();
+  schedule_poll(ready_pin_ >= 0 ? 2 * conversion_time : conversion_time);
+}
+
+void ADS1115Async::schedule_poll(unsigned int delay) {
+  unsigned long id = conversion_id_;
+  OnDelay("ADS1115 poll", delay, [this, id]() {
+    if (busy_ && id == conversion_id_) {
+      poll();
+    }
+  });
+}
+
+void ADS1115Async::poll() {
+  if (ready_ ||
+      i2c_transaction([this]() { return ads1115_->conversionComplete(); })) {
+    finish();
+    return;
+  }
+  if (millis() - start_time_ >
+      kADS1115TimeoutFactor * get_conversion_time()) {
+    debugW("ADS1115 conversion on channel %d timed out", current_.channel);
+    start_next();
+    return;
+  }
+  schedule_poll(1);
+}
+
+void ADS1115Async::finish() {
+  ADS1115Sample sample;
+  sample.channel = current_.channel;
+  sample.gain = current_.gain;
+  sample.raw = i2c_transaction(
+      [this]() { return ads1115_->getLastConversionResults(); });
+  sample.volts = sample.raw * ADS1115FullScaleRange(sample.gain) / 32768;
+  sample.timestamp_us = start_time_us_;
+  Callback callback = std::move(current_.callback);
+  // Start the next conversion before running the callback so the chip
+  // converts while the callback runs.
+  start_next();
+  callback(sample);
+}
+
+ADS1115Sequencer::ADS1115Sequencer(Adafruit_ADS1115* ads1115,
+                                   adsGain_t default_gain, int ready_pin,
+                                   I2CScheduler* i2c, int i2c_client)
+    : adc_{ads1115, ready_pin, i2c, i2c_client}, default_gain_{default_gain} {}
+
+int ADS1115Sequencer::subscribe(int channel, unsigned int interval,
+                                adsGain_t gain, Callback callback) {
+  if (channel < 0 || channel > 3 || num_subscriptions_ == kMaxSubscriptions) {
+    debugE("ADS1115 subscription for channel %d rejected", channel);
+    return -1;
+  }
+
+  float available = kADS1115MaxUtilization - get_utilization();
+  if (available <= 0) {
+    debugE("ADS1115 fully booked, subscription for channel %d rejected",
+           channel);
+    return -1;
+  }
+  interval = fit_interval(channel, interval, available);
+
+  int id = num_subscriptions_++;
+  subscriptions_[id] = {channel, gain, interval, millis(), callback,
+                        false, 0, 0};
+  schedule_service(0);
+  return id;
+}
+
+int ADS1115Sequencer::subscribe_auto_gain(int channel, unsigned int interval,
+                                          Callback callback) {
+  int id = subscribe(channel, interval, default_gain_, callback);
+  if (id >= 0) {
+    subscriptions_[id].auto_gain = true;
+  }
+  return id;
+}
+
+void ADS1115Sequencer::adjust_gain(Subscription& sub,
+                                   const ADS1115Sample& sample) {
+  int index = 0;
+  while (index < kADS1115NumGains - 1 && kADS1115Gains[index] != sub.gain) {
+    index++;
+  }
+
+  int16_t magnitude = sample.raw < 0 ? -(sample.raw + 1) : sample.raw;
+  if (magnitude > kADS1115GainDownThreshold * 32767) {
+    if (index > 0) {
+      sub.gain = kADS1115Gains[index - 1];
+    }
+    sub.window_peak = 0;
+    sub.window_samples = 0;
+    return;
+  }
+
+  if (magnitude > sub.window_peak) {
+    sub.window_peak = magnitude;
+  }
+  if (++sub.window_samples < kADS1115GainUpWindow) {
+    return;
+  }
+  if (index < kADS1115NumGains - 1) {
+    float peak_volts =
+        sub.window_peak * ADS1115FullScaleRange(sub.gain) / 32768;
+    float next_range = ADS1115FullScaleRange(kADS1115Gains[index + 1]);
+    if (peak_volts < kADS1115GainUpThreshold * next_range) {
+      sub.gain = kADS1115Gains[index + 1];
+    }
+  }
+  sub.window_peak = 0;
+  sub.window_samples = 0;
+}
+
+void ADS1115Sequencer::set_interval(int id, unsigned int interval) {
+  if (id < 0 || id >= num_subscriptions_) {
+    return;
+  }
+  Subscription& sub = subscriptions_[id];
+  float available = kADS1115MaxUtilization - get_utilization() +
+                    utilization(sub.interval);
+  sub.interval = fit_interval(sub.channel, interval, available);
+  // Apply a shorter interval right away instead of after the old one
+  unsigned long now = millis();
+  if ((long)(sub.next_due - (now + sub.interval)) > 0) {
+    sub.next_due = now + sub.interval;
+  }
+  schedule_service(0);
+}
+
+unsigned int ADS1115Sequencer::fit_interval(int channel, unsigned int interval,
+                                            float available) const {
+  if (interval == 0) {
+    interval = 1;
+  }
+  if (utilization(interval) > available) {
+    unsigned int min_interval =
+        (unsigned int)(adc_.get_conversion_time() / available) + 1;
+    debugW("ADS1115 channel %d interval raised from %u to %u ms to fit the "
+           "conversion rate",
+           channel, interval, min_interval);
+    interval = min_interval;
+  }
+  return interval;
+}
+
+float ADS1115Sequencer::get_utilization() const {
+  float total = 0;
+  for (int i = 0; i < num_subscriptions_; i++) {
+    total += utilization(subscriptions_[i].interval);
+  }
+  return total;
+}
+
+float ADS1115Sequencer::utilization(unsigned int interval) const {
+  return (float)adc_.get_conversion_time() / interval;
+}
+
+void ADS1115Sequencer::schedule_service(unsigned long delay) {
+  unsigned long id = ++service_id_;
+  OnDelay("ADS1115 sequencer", delay, [this, id]() {
+    if (id == service_id_) {
+      service();
+    }
+  });
+}
+
+void ADS1115Sequencer::service() {
+  if (num_subscriptions_ == 0) {
+    return;
+  }
+  if (adc_.is_busy()) {
+    // The completion callback calls service() again. Keep a fallback in
+    // case the conversion times out.
+    schedule_service((kADS1115TimeoutFactor + 1) * adc_.get_conversion_time());
+    return;
+  }
+
+  // Pick the subscription with the earliest deadline. Scanning from the one
+  // after the last served breaks ties round-robin.
+  unsigned long now = millis();
+  int next = -1;
+  long earliest = 0;
+  for (int n = 1; n <= num_subscriptions_; n++) {
+    int i = (last_served_ + n) % num_subscriptions_;
+    long until_due = (long)(subscriptions_[i].next_due - now);
+    if (next == -1 || until_due < earliest) {
+      next = i;
+      earliest = until_due;
+    }
+  }
+
+  if (earliest > 0) {
+    schedule_service(earliest);
+    return;
+  }
+
+  Subscription& sub = subscriptions_[next];
+  last_served_ = next;
+  sub.next_due += sub.interval;
+  if ((long)(now - sub.next_due) > 0) {
+    // Fell behind by more than one interval; don't try to catch up.
+    sub.next_due = now + sub.interval;
+  }
+
+  adc_.read(sub.channel, sub.gain, [this, next](const ADS1115Sample& sample) {
+    Subscription& sub = subscriptions_[next];
+    if (sub.auto_gain) {
+      // Applies from the next conversion of this channel
+      adjust_gain(sub, sample);
+    }
+    sub.callback(sample);
+    service();
+  });
+  // Keep the schedule going if the conversion times out and the callback
+  // never runs.
+  schedule_service((kADS1115TimeoutFactor + 1) * adc_.get_conversion_time());
+}
+
+ADS1115Registry::ADS1115Registry(I2CScheduler* i2c, uint8_t onboard_address,
+                                 adsGain_t default_gain,
+                                 int onboard_ready_pin) {
+  const uint8_t kADS1115Addresses[] = {0x48, 0x49, 0x4a, 0x4b};
+
+  // The on-board chip comes first and is registered even if the probe
+  // fails, so that chip numbers stay stable.
+  uint8_t addresses[kMaxChips];
+  int num_addresses = 0;
+  addresses[num_addresses++] = onboard_address;
+  for (uint8_t address : kADS1115Addresses) {
+    if (address != onboard_address) {
+      addresses[num_addresses++] = address;
+    }
+  }
+
+  int i2c_client = i2c->add_client("ADC", I2CScheduler::Priority::kHigh);
+
+  for (int i = 0; i < num_addresses; i++) {
+    auto ads1115 = new Adafruit_ADS1115();
+    bool present = ads1115->begin(addresses[i], i2c->get_bus());
+    if (!present && i > 0) {
+      delete ads1115;
+      continue;
+    }
+    debugI("ADS1115 chip %d at 0x%02x%s", num_chips_, addresses[i],
+           present ? "" : " not responding");
+    int ready_pin = i == 0 ? onboard_ready_pin : -1;
+    chips_[num_chips_++] = {
+        addresses[i], new ADS1115Sequencer(ads1115, default_gain, ready_pin,
+                                           i2c, i2c_client)};
+  }
+}
+
+}  // namespace halmet
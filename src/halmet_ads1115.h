@@ -0,0 +1,240 @@
+#ifndef HALMET_SRC_HALMET_ADS1115_H_
+#define HALMET_SRC_HALMET_ADS1115_H_
+
+#include <Adafruit_ADS1X15.h>
+
+#include <functional>
+
+#include "halmet_i2c.h"
+#include "spsc_queue.h"
+
+namespace halmet {
+
+/// A completed ADS1115 conversion.
+struct ADS1115Sample {
+  int channel;
+  adsGain_t gain;
+  int16_t raw;
+  float volts;                 // Voltage at the ADC input
+  unsigned long timestamp_us;  // micros() at the start of the conversion
+};
+
+/// Full-scale input voltage of the ADS1115 PGA at the given gain
+float ADS1115FullScaleRange(adsGain_t gain);
+
+/**
+ * @brief Non-blocking single-ended reads from an ADS1115.
+ *
+ * Adafruit_ADS1115::readADC_SingleEnded() starts a conversion and then
+ * busy-waits for it, stalling the event loop for a full conversion period.
+ * Here a read only starts the conversion. The result is collected when the
+ * ALERT/RDY pin signals completion, or, if no pin is connected, by a poll
+ * scheduled after the nominal conversion time. The callback then runs on
+ * the event loop.
+ *
+ * Reads requested while a conversion is in progress are queued and run in
+ * order.
+ */
+class ADS1115Async {
+ public:
+  using Callback = std::function<void(const ADS1115Sample& sample)>;
+
+  /**
+   * @param ads1115 Initialized ADS1115 driver
+   * @param ready_pin GPIO connected to the ALERT/RDY output, or -1 to poll
+   * @param i2c Bus scheduler to run the transfers through, if any
+   * @param i2c_client Scheduler client id
+   */
+  ADS1115Async(Adafruit_ADS1115* ads1115, int ready_pin = -1,
+               I2CScheduler* i2c = nullptr, int i2c_client = -1);
+
+  /// Queue a single-ended read. Returns false if the queue is full.
+  bool read(int channel, adsGain_t gain, Callback callback);
+
+  bool is_busy() const { return busy_; }
+
+  /// Nominal conversion time at the configured data rate, in ms
+  unsigned int get_conversion_time() const;
+
+  unsigned long get_dropped_reads() const { return queue_.get_dropped(); }
+
+ protected:
+  struct Request {
+    int channel;
+    adsGain_t gain;
+    Callback callback;
+  };
+
+  static void IRAM_ATTR ready_isr(void* arg);
+
+  template <typename F>
+  auto i2c_transaction(F&& fn) -> decltype(fn()) {
+    if (i2c_ != nullptr) {
+      return i2c_->run(i2c_client_, fn);
+    }
+    return fn();
+  }
+
+  void start_next();
+  void schedule_poll(unsigned int delay);
+  void poll();
+  void finish();
+
+  Adafruit_ADS1115* ads1115_;
+  int ready_pin_;
+  I2CScheduler* i2c_;
+  int i2c_client_;
+  SpscQueue<Request, 8> queue_;
+
+  bool busy_ = false;
+  Request current_;
+  unsigned long start_time_ = 0;
+  unsigned long start_time_us_ = 0;
+  // Incremented for every conversion so that polls scheduled for an earlier
+  // conversion can be recognized and ignored.
+  unsigned long conversion_id_ = 0;
+  volatile bool ready_ = false;
+};
+
+/**
+ * @brief Schedules all reads from one ADS1115.
+ *
+ * The sequencer owns the chip: consumers subscribe to a channel with a
+ * sample interval and PGA gain instead of reading it themselves. Due
+ * subscriptions are converted one at a time, earliest deadline first and
+ * round-robin among equal deadlines, so reads never collide on the input
+ * mux and a busy channel cannot starve the others.
+ *
+ * The total requested sample rate is checked against the conversion rate
+ * of the chip. A subscription that does not fit gets a longer interval
+ * and a warning.
+ */
+class ADS1115Sequencer {
+ public:
+  using Callback = ADS1115Async::Callback;
+
+  /**
+   * @param ads1115 Initialized ADS1115 driver
+   * @param default_gain Gain for subscriptions that don't specify one
+   * @param ready_pin GPIO connected to the ALERT/RDY output, or -1 to poll
+   * @param i2c Bus scheduler to run the transfers through, if any
+   * @param i2c_client Scheduler client id
+   */
+  ADS1115Sequencer(Adafruit_ADS1115* ads1115, adsGain_t default_gain,
+                   int ready_pin = -1, I2CScheduler* i2c = nullptr,
+                   int i2c_client = -1);
+
+  /**
+   * @brief Sample a channel periodically.
+   *
+   * @param channel Single-ended input, 0-3
+   * @param interval Sample interval, in ms
+   * @param callback Called on the event loop with every sample
+   * @return Subscription id, or -1 if the subscription was rejected
+   */
+  int subscribe(int channel, unsigned int interval, Callback callback) {
+    return subscribe(channel, interval, default_gain_, callback);
+  }
+  int subscribe(int channel, unsigned int interval, adsGain_t gain,
+                Callback callback);
+
+  /**
+   * @brief Sample a channel periodically with automatic gain ranging.
+   *
+   * The gain starts at the default gain. It is lowered as soon as a sample
+   * comes close to the full-scale range and raised one step when the recent
+   * peak would fit comfortably in the next range. The gain is part of the
+   * configuration written to start each conversion, so switching costs no
+   * extra conversions or I2C transfers.
+   */
+  int subscribe_auto_gain(int channel, unsigned int interval,
+                          Callback callback);
+
+  /// Change the interval of a subscription. The same capacity check as in
+  /// subscribe() applies. Call from the event loop.
+  void set_interval(int id, unsigned int interval);
+
+  /// Fraction of the ADC conversion capacity in use
+  float get_utilization() const;
+
+ protected:
+  struct Subscription {
+    int channel;
+    adsGain_t gain;
+    unsigned int interval;
+    unsigned long next_due;
+    Callback callback;
+    bool auto_gain;
+    // Largest absolute reading and sample count in the current step-up
+    // window
+    int16_t window_peak;
+    int window_samples;
+  };
+
+  static const int kMaxSubscriptions = 8;
+
+  void service();
+  void schedule_service(unsigned long delay);
+  void adjust_gain(Subscription& sub, const ADS1115Sample& sample);
+  float utilization(unsigned int interval) const;
+  unsigned int fit_interval(int channel, unsigned int interval,
+                            float available) const;
+
+  ADS1115Async adc_;
+  adsGain_t default_gain_;
+  Subscription subscriptions_[kMaxSubscriptions];
+  int num_subscriptions_ = 0;
+  int last_served_ = -1;
+  // Identifies the latest scheduled service call; older ones are ignored.
+  unsigned long service_id_ = 0;
+};
+
+/**
+ * @brief All ADS1115 chips on the I2C bus.
+ *
+ * The ADS1115 address pin selects one of four addresses, 0x48-0x4b. The
+ * on-board chip is always chip 0; external chips found at the other
+ * addresses at boot follow in address order. Analog inputs are addressed
+ * as (chip, channel): get(chip) returns the chip's sequencer.
+ *
+ * Each chip has its own sequencer. The chips convert in parallel and the
+ * bus is only busy for the short register transfers, so total throughput
+ * grows with the number of chips. All chips share one high-priority I2C
+ * scheduler client.
+ */
+class ADS1115Registry {
+ public:
+  /**
+   * @param i2c Scheduler of the I2C bus the chips are on
+   * @param onboard_address Address of the on-board chip
+   * @param default_gain Default gain for all chips
+   * @param onboard_ready_pin GPIO connected to the on-board chip's
+   *   ALERT/RDY output, or -1 to poll
+   */
+  ADS1115Registry(I2CScheduler* i2c, uint8_t onboard_address,
+                  adsGain_t default_gain, int onboard_ready_pin = -1);
+
+  int size() const { return num_chips_; }
+
+  /// Sequencer of a chip, or nullptr if there is no such chip
+  ADS1115Sequencer* get(int chip) const {
+    return chip >= 0 && chip < num_chips_ ? chips_[chip].sequencer : nullptr;
+  }
+
+  uint8_t get_address(int chip) const { return chips_[chip].address; }
+
+ protected:
+  static const int kMaxChips = 4;
+
+  struct Chip {
+    uint8_t address;
+    ADS1115Sequencer* sequencer;
+  };
+
+  Chip chips_[kMaxChips];
+  int num_chips_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_ADS1115_H_
@@ -0,0 +1,95 @@
+#include "halmet_alarm_input.h"
+
+#include "halmet_profiler.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+AlarmInput::AlarmInput(int pin, String config_path)
+    : sensesp::BoolSensor(config_path), pin_{pin} {
+  load();
+
+  pinMode(pin_, INPUT);
+  state_ = digitalRead(pin_);
+  change_us_ = micros();
+  attachInterruptArg(pin_, edge_isr, this, CHANGE);
+
+  OnTick("Alarm input edge", [this]() {
+    if (edge_pending_.exchange(false)) {
+      check();
+    }
+  });
+
+  // Report the initial state once the event loop runs
+  OnDelay("Alarm input initial", 0, [this]() {
+    change_us_ = micros();
+    this->emit(state_);
+  });
+}
+
+void IRAM_ATTR AlarmInput::edge_isr(void* arg) {
+  auto self = static_cast<AlarmInput*>(arg);
+  if (!self->edge_pending_) {
+    self->first_edge_us_ = micros();
+  }
+  self->edge_count_++;
+  self->edge_pending_ = true;
+}
+
+void AlarmInput::check() {
+  if (confirming_) {
+    // The pending confirmation sees the new edges
+    return;
+  }
+  if (digitalRead(pin_) == state_) {
+    // Bounced back before we got to it
+    return;
+  }
+  confirming_ = true;
+  confirm_edge_count_ = edge_count_;
+  change_us_ = first_edge_us_;
+  OnDelay("Alarm input debounce", debounce_time_, [this]() { confirm(); });
+}
+
+void AlarmInput::confirm() {
+  confirming_ = false;
+  bool level = digitalRead(pin_);
+  uint32_t edge_count = edge_count_;
+  if (edge_count != confirm_edge_count_) {
+    // Still bouncing; start over from the latest edge
+    if (level != state_) {
+      confirming_ = true;
+      confirm_edge_count_ = edge_count;
+      OnDelay("Alarm input debounce", debounce_time_, [this]() { confirm(); });
+    }
+    return;
+  }
+  if (level != state_) {
+    state_ = level;
+    this->emit(state_);
+  }
+}
+
+bool AlarmInput::to_json(JsonObject& root) {
+  root["debounce_time"] = (unsigned int)debounce_time_;
+  return true;
+}
+
+bool AlarmInput::from_json(const JsonObject& config) {
+  if (!config["debounce_time"].is<unsigned int>()) {
+    return false;
+  }
+  debounce_time_ = config["debounce_time"].as<unsigned int>();
+  return true;
+}
+
+const String ConfigSchema(const AlarmInput& obj) {
+  return R"###({
+    "type": "object",
+    "properties": {
+      "debounce_time": { "title": "Debounce time", "type": "integer", "minimum": 0, "description": "Time the input must hold a new level before the change is reported, in milliseconds" }
+    }
+  })###";
+}
+
+}  // namespace halmet
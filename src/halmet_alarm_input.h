@@ -0,0 +1,58 @@
+#ifndef HALMET_SRC_HALMET_ALARM_INPUT_H_
+#define HALMET_SRC_HALMET_ALARM_INPUT_H_
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "sensesp/sensors/sensor.h"
+
+namespace halmet {
+
+/**
+ * @brief Edge-triggered, debounced digital alarm input.
+ *
+ * An interrupt on either edge flags the input; nothing runs while the
+ * input is quiet. A change is confirmed once the pin has held its new level
+ * for the debounce time without further edges, and is emitted right away.
+ * Bounces restart the debounce time; a pulse shorter than it is ignored.
+ *
+ * The output is the pin level: true when high.
+ */
+class AlarmInput : public sensesp::BoolSensor {
+ public:
+  AlarmInput(int pin, String config_path = "");
+
+  /// Time of the first edge of the last reported change, in us
+  uint32_t get_change_time() const { return change_us_; }
+
+  virtual bool to_json(JsonObject& root) override;
+  virtual bool from_json(const JsonObject& config) override;
+
+ protected:
+  static void IRAM_ATTR edge_isr(void* arg);
+  void check();
+  void confirm();
+
+  int pin_;
+  std::atomic<unsigned int> debounce_time_{20};  // ms
+
+  // Written by the interrupt handler
+  std::atomic<bool> edge_pending_{false};
+  std::atomic<uint32_t> edge_count_{0};
+  std::atomic<uint32_t> first_edge_us_{0};
+
+  // Debounce state; only accessed on the event loop
+  bool state_;
+  bool confirming_ = false;
+  uint32_t confirm_edge_count_ = 0;
+  uint32_t change_us_;
+};
+
+const String ConfigSchema(const AlarmInput& obj);
+
+inline bool ConfigRequiresRestart(const AlarmInput& obj) { return false; }
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_ALARM_INPUT_H_
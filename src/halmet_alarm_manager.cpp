@@ -0,0 +1,197 @@
+#include "halmet_alarm_manager.h"
+
+#include "halmet_profiler.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+const char* AlarmSeverityName(AlarmSeverity severity) {
+  switch (severity) {
+    case AlarmSeverity::kAlert:
+      return "alert";
+    case AlarmSeverity::kWarn:
+      return "warn";
+    case AlarmSeverity::kAlarm:
+      return "alarm";
+    case AlarmSeverity::kEmergency:
+      return "emergency";
+  }
+  return "alarm";
+}
+
+Alarm::Alarm(String name, String message, String notification_path,
+             AlarmSeverity severity, bool active_low, bool latching,
+             String config_path)
+    : sensesp::ValueProducer<bool>(),
+      sensesp::FileSystemSaveable(config_path),
+      name_{name},
+      message_{message},
+      notification_path_{notification_path},
+      severity_{severity},
+      active_low_{active_low},
+      latching_{latching} {
+  load();
+}
+
+String Alarm::get_notification() const {
+  JsonDocument doc;
+  JsonArray method = doc["method"].to<JsonArray>();
+  if (active_) {
+    doc["state"] = AlarmSeverityName(severity_);
+    method.add("visual");
+    if (!acknowledged_) {
+      method.add("sound");
+    }
+  } else {
+    doc["state"] = "normal";
+  }
+  doc["message"] = message_;
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+bool Alarm::to_json(JsonObject& root) {
+  root["severity"] = AlarmSeverityName(severity_);
+  root["active_low"] = (bool)active_low_;
+  root["latching"] = (bool)latching_;
+  return true;
+}
+
+bool Alarm::from_json(const JsonObject& config) {
+  if (!config["severity"].is<String>() || !config["active_low"].is<bool>() ||
+      !config["latching"].is<bool>()) {
+    return false;
+  }
+  String severity = config["severity"].as<String>();
+  for (auto candidate : {AlarmSeverity::kAlert, AlarmSeverity::kWarn,
+                         AlarmSeverity::kAlarm, AlarmSeverity::kEmergency}) {
+    if (severity == AlarmSeverityName(candidate)) {
+      severity_ = candidate;
+    }
+  }
+  active_low_ = config["active_low"].as<bool>();
+  latching_ = config["latching"].as<bool>();
+
+  if (manager_ != nullptr) {
+    // Apply the new settings to the current state
+    OnDelay("Alarm settings", 0,
+            [this]() { manager_->evaluate(this, micros(), true); });
+  }
+  return true;
+}
+
+const String ConfigSchema(const Alarm& obj) {
+  return R"###({
+    "type": "object",
+    "properties": {
+      "severity": { "title": "Severity", "type": "string", "enum": ["alert", "warn", "alarm", "emergency"], "description": "Signal K notification state while the alarm is active" },
+      "active_low": { "title": "Active low", "type": "boolean", "description": "Alarm when the input is low instead of high" },
+      "latching": { "title": "Latching", "type": "boolean", "description": "Keep the alarm active after the input clears until it is acknowledged" }
+    }
+  })###";
+}
+
+Alarm* AlarmManager::add_alarm(Alarm* alarm,
+                               sensesp::ValueProducer<bool>* source) {
+  connect(alarm, source, []() { return (uint32_t)micros(); });
+  return alarm;
+}
+
+Alarm* AlarmManager::add_alarm(Alarm* alarm, AlarmInput* input) {
+  connect(alarm, input, [input]() { return input->get_change_time(); });
+  return alarm;
+}
+
+void AlarmManager::add_observer(Observer observer) {
+  observers_.push_back(observer);
+}
+
+void AlarmManager::enable_notifications() {
+  if (notifications_enabled_) {
+    return;
+  }
+  notifications_enabled_ = true;
+  for (auto alarm : alarms_) {
+    create_notification_output(alarm);
+  }
+}
+
+void AlarmManager::acknowledge(Alarm* alarm) {
+  if (!alarm->active_ || alarm->acknowledged_) {
+    return;
+  }
+  alarm->acknowledged_ = true;
+  // A latched alarm whose source has cleared goes inactive
+  evaluate(alarm, micros(), true);
+}
+
+void AlarmManager::acknowledge_all() {
+  for (auto alarm : alarms_) {
+    acknowledge(alarm);
+  }
+}
+
+void AlarmManager::connect(Alarm* alarm, sensesp::ValueProducer<bool>* source,
+                           std::function<uint32_t()> event_time) {
+  alarm->manager_ = this;
+  alarms_.push_back(alarm);
+  if (notifications_enabled_) {
+    create_notification_output(alarm);
+  }
+  source->connect_to(
+      new sensesp::LambdaConsumer<bool>([this, alarm, event_time](bool level) {
+        alarm->level_ = level;
+        evaluate(alarm, event_time());
+      }));
+}
+
+void AlarmManager::create_notification_output(Alarm* alarm) {
+  alarm->notification_output_ =
+      new sensesp::SKOutputRawJson(alarm->get_notification_path());
+  alarm->notification_output_->set(alarm->get_notification());
+}
+
+void AlarmManager::evaluate(Alarm* alarm, uint32_t event_us, bool force) {
+  bool input = alarm->level_ != alarm->active_low_;
+  bool active =
+      input || (alarm->latching_ && alarm->active_ && !alarm->acknowledged_);
+  // An acknowledgement only covers the activation it was given for
+  bool acknowledged = active && alarm->active_ && alarm->acknowledged_;
+
+  if (!force && active == alarm->active_ &&
+      acknowledged == alarm->acknowledged_) {
+    return;
+  }
+  alarm->active_ = active;
+  alarm->acknowledged_ = acknowledged;
+  alarm->event_us_ = event_us;
+  notify(alarm);
+}
+
+void AlarmManager::notify(Alarm* alarm) {
+  alarm->emit(alarm->active_);
+  if (alarm->notification_output_ != nullptr) {
+    alarm->notification_output_->set(alarm->get_notification());
+  }
+  for (auto& observer : observers_) {
+    observer(*alarm);
+  }
+
+  uint32_t latency = micros() - alarm->event_us_;
+  stats_.changes++;
+  stats_.last_latency_us = latency;
+  if (latency > stats_.max_latency_us) {
+    stats_.max_latency_us = latency;
+  }
+
+  const char* state = "clear";
+  if (alarm->active_) {
+    state = alarm->acknowledged_ ? "acknowledged" : "active";
+  }
+  debugD("Alarm %s %s, latency %lu us", alarm->get_name().c_str(), state,
+         (unsigned long)latency);
+}
+
+}  // namespace halmet
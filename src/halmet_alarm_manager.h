@@ -0,0 +1,152 @@
+#ifndef HALMET_SRC_HALMET_ALARM_MANAGER_H_
+#define HALMET_SRC_HALMET_ALARM_MANAGER_H_
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "halmet_alarm_input.h"
+#include "sensesp/signalk/signalk_output.h"
+#include "sensesp/system/saveable.h"
+#include "sensesp/system/valueproducer.h"
+
+namespace halmet {
+
+class AlarmManager;
+
+/// Signal K notification states used for active alarms
+enum class AlarmSeverity { kAlert, kWarn, kAlarm, kEmergency };
+
+const char* AlarmSeverityName(AlarmSeverity severity);
+
+/**
+ * @brief Alarm definition and state.
+ *
+ * The alarm is driven by a boolean source through an AlarmManager. The
+ * polarity, severity and latching can be changed without a restart.
+ *
+ * A latching alarm stays active after its source clears until it is
+ * acknowledged. Acknowledging an alarm that is still active silences it,
+ * i.e. removes the sound method from its notification.
+ *
+ * The alarm emits its active state on every change, e.g. for NMEA 2000
+ * engine status bits.
+ */
+class Alarm : public sensesp::ValueProducer<bool>,
+              public sensesp::FileSystemSaveable {
+ public:
+  /**
+   * @param name Short name, e.g. the input name
+   * @param message Notification message
+   * @param notification_path Signal K path, starting with "notifications."
+   * @param severity Notification state while active
+   * @param active_low Alarm on a false source value
+   * @param latching Stay active until acknowledged
+   * @param config_path Configuration path
+   */
+  Alarm(String name, String message, String notification_path,
+        AlarmSeverity severity = AlarmSeverity::kAlarm,
+        bool active_low = false, bool latching = false,
+        String config_path = "");
+
+  const String& get_name() const { return name_; }
+  const String& get_message() const { return message_; }
+  const String& get_notification_path() const { return notification_path_; }
+  AlarmSeverity get_severity() const { return severity_; }
+  bool is_active() const { return active_; }
+  bool is_acknowledged() const { return acknowledged_; }
+
+  /// Time of the source change that caused the last state change, in us
+  uint32_t get_event_time() const { return event_us_; }
+
+  /// Signal K notification value for the current state
+  String get_notification() const;
+
+  virtual bool to_json(JsonObject& root) override;
+  virtual bool from_json(const JsonObject& config) override;
+
+ protected:
+  friend class AlarmManager;
+
+  String name_;
+  String message_;
+  String notification_path_;
+
+  // Settings
+  std::atomic<AlarmSeverity> severity_;
+  std::atomic<bool> active_low_;
+  std::atomic<bool> latching_;
+
+  // State; only accessed on the event loop
+  AlarmManager* manager_ = nullptr;
+  sensesp::SKOutputRawJson* notification_output_ = nullptr;
+  bool level_ = false;
+  bool active_ = false;
+  bool acknowledged_ = false;
+  uint32_t event_us_ = 0;
+};
+
+const String ConfigSchema(const Alarm& obj);
+
+inline bool ConfigRequiresRestart(const Alarm& obj) { return false; }
+
+/**
+ * @brief Owner of the alarms and single point of alarm state propagation.
+ *
+ * Source values are evaluated as they arrive. A state change is fanned out
+ * at once, on the same event loop tick, to the alarm's own consumers, the
+ * Signal K notification and the observers added with add_observer(). No
+ * consumer polls the alarm state.
+ *
+ * Each change is logged with its latency: the time from the source change
+ * to the end of the fan-out. For AlarmInput sources, this starts at the
+ * first edge on the pin and includes the debounce time.
+ */
+class AlarmManager {
+ public:
+  using Observer = std::function<void(const Alarm&)>;
+
+  struct Stats {
+    unsigned long changes = 0;
+    uint32_t last_latency_us = 0;
+    uint32_t max_latency_us = 0;
+  };
+
+  /// Add an alarm driven by any boolean source.
+  Alarm* add_alarm(Alarm* alarm, sensesp::ValueProducer<bool>* source);
+  /// Add an alarm driven by an alarm input, measuring from the pin edge.
+  Alarm* add_alarm(Alarm* alarm, AlarmInput* input);
+
+  /// Called after every alarm state change
+  void add_observer(Observer observer);
+
+  /// Publish all alarms as Signal K notifications.
+  void enable_notifications();
+
+  void acknowledge(Alarm* alarm);
+  void acknowledge_all();
+
+  const std::vector<Alarm*>& get_alarms() const { return alarms_; }
+
+  Stats get_stats() const { return stats_; }
+
+ protected:
+  friend class Alarm;
+
+  void connect(Alarm* alarm, sensesp::ValueProducer<bool>* source,
+               std::function<uint32_t()> event_time);
+  void create_notification_output(Alarm* alarm);
+  void evaluate(Alarm* alarm, uint32_t event_us, bool force = false);
+  void notify(Alarm* alarm);
+
+  std::vector<Alarm*> alarms_;
+  std::vector<Observer> observers_;
+  bool notifications_enabled_ = false;
+  Stats stats_;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_ALARM_MANAGER_H_
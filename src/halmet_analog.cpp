@@ -1,9 +1,11 @@
 #include "halmet_analog.h"
 
+#include "halmet_curve.h"
+#include "halmet_tank_filter.h"
 #include "sensesp/sensors/sensor.h"
 #include "sensesp/signalk/signalk_output.h"
+#include "sensesp/system/observablevalue.h"
 #include "sensesp/system/valueproducer.h"
-#include "sensesp/transforms/curveinterpolator.h"
 #include "sensesp/transforms/linear.h"
 #include "sensesp/ui/config_item.h"
 
@@ -15,21 +17,46 @@ const float kMeasurementCurrent = 0.01;
 // Default fuel tank size, in m3
 const float kTankDefaultSize = 120. / 1000;
 
-sensesp::FloatProducer* ConnectTankSender(Adafruit_ADS1115* ads1115,
-                                          int channel, const String& name,
-                                          const String& sk_id, int sort_order,
-                                          bool enable_signalk_output) {
-  const uint ads_read_delay = 500;  // ms
+sensesp::FloatProducer* ConnectTankSender(
+    ADS1115Sequencer* ads1115, int channel, const String& name,
+    const String& sk_id, int sort_order, bool enable_signalk_output,
+    sensesp::FloatProducer** tank_volume) {
+  // Sample fast and let the filter below smooth out the sloshing.
+  const uint ads_read_delay = 100;  // ms
 
-  // Configure the sender resistance sensor
+  // Configure the sender resistance sensor. The sequencer emits a sample
+  // every read interval.
 
-  auto sender_resistance =
-      new sensesp::RepeatSensor<float>(ads_read_delay, [ads1115, channel]() {
-        int16_t adc_output = ads1115->readADC_SingleEnded(channel);
-        float adc_output_volts = ads1115->computeVolts(adc_output);
-        return kVoltageDividerScale * adc_output_volts / kMeasurementCurrent;
+  auto sender_resistance = new sensesp::ObservableValue<float>();
+
+  ads1115->subscribe_auto_gain(
+      channel, ads_read_delay, [sender_resistance](const ADS1115Sample& sample) {
+        sender_resistance->set(kVoltageDividerScale * sample.volts /
+                               kMeasurementCurrent);
       });
 
+  // Configure the filter for the sender readings
+
+  char filter_config_path[80];
+  snprintf(filter_config_path, sizeof(filter_config_path),
+           "/Tanks/%s/Sender Filter", name.c_str());
+  char filter_title[80];
+  snprintf(filter_title, sizeof(filter_title), "%s Tank Sender Filter",
+           name.c_str());
+  char filter_description[80];
+  snprintf(filter_description, sizeof(filter_description),
+           "Smoothing of the %s tank sender readings", name.c_str());
+
+  auto filtered_resistance =
+      new TankSenderFilter(ads_read_delay, filter_config_path);
+
+  ConfigItem(filtered_resistance)
+      ->set_title(filter_title)
+      ->set_description(filter_description)
+      ->set_sort_order(sort_order + 5);
+
+  sender_resistance->connect_to(filtered_resistance);
+
   if (enable_signalk_output) {
     char resistance_sk_config_path[80];
     snprintf(resistance_sk_config_path, sizeof(resistance_sk_config_path),
@@ -61,7 +88,7 @@ sensesp::FloatProducer* ConnectTankSender(Adafruit_ADS1115* ads1115,
         ->set_description(resistance_description)
         ->set_sort_order(sort_order);
 
-    sender_resistance->connect_to(sender_resistance_sk_output);
+    filtered_resistance->connect_to(sender_resistance_sk_output);
   }
 
   // Configure the piecewise linear interpolator for the tank level (ratio)
@@ -76,9 +103,9 @@ sensesp::FloatProducer* ConnectTankSender(Adafruit_ADS1115* ads1115,
   snprintf(curve_description, sizeof(curve_description),
            "Piecewise linear curve for the %s tank level", name.c_str());
 
-  auto tank_level = (new sensesp::CurveInterpolator(nullptr, curve_config_path))
-                        ->set_input_title("Sender Resistance (ohms)")
-                        ->set_output_title("Fuel Level (ratio)");
+  auto tank_level = new CompiledCurveInterpolator(nullptr, curve_config_path);
+  tank_level->set_input_title("Sender Resistance (ohms)")
+      ->set_output_title("Fuel Level (ratio)");
 
   ConfigItem(tank_level)
       ->set_title(curve_title)
@@ -91,9 +118,10 @@ sensesp::FloatProducer* ConnectTankSender(Adafruit_ADS1115* ads1115,
     tank_level->add_sample(sensesp::CurveInterpolator::Sample(0, 0));
     tank_level->add_sample(sensesp::CurveInterpolator::Sample(180., 1));
     tank_level->add_sample(sensesp::CurveInterpolator::Sample(1000., 1));
+    tank_level->compile();
   }
 
-  sender_resistance->connect_to(tank_level);
+  filtered_resistance->connect_to(tank_level);
 
   if (enable_signalk_output) {
     char level_config_path[80];
@@ -139,15 +167,18 @@ sensesp::FloatProducer* ConnectTankSender(Adafruit_ADS1115* ads1115,
   char volume_description[80];
   snprintf(volume_description, sizeof(volume_description),
            "Calculated total volume of the %s tank", name.c_str());
-  auto tank_volume =
-      new sensesp::Linear(kTankDefaultSize, 0, volume_config_path);
+  auto volume = new sensesp::Linear(kTankDefaultSize, 0, volume_config_path);
 
-  ConfigItem(tank_volume)
+  ConfigItem(volume)
       ->set_title(volume_title)
       ->set_description(volume_description)
       ->set_sort_order(sort_order + 3);
 
-  tank_level->connect_to(tank_volume);
+  tank_level->connect_to(volume);
+
+  if (tank_volume != nullptr) {
+    *tank_volume = volume;
+  }
 
   if (enable_signalk_output) {
     char volume_sk_config_path[80];
@@ -179,7 +210,7 @@ sensesp::FloatProducer* ConnectTankSender(Adafruit_ADS1115* ads1115,
         ->set_description(volume_description)
         ->set_sort_order(sort_order + 4);
 
-    tank_volume->connect_to(tank_volume_sk_output);
+    volume->connect_to(tank_volume_sk_output);
   }
 
   return tank_level;
@@ -1,8 +1,10 @@
 #ifndef HALMET_ANALOG_H_
 #define HALMET_ANALOG_H_
 
-#include <Adafruit_ADS1X15.h>
+#include <atomic>
 
+#include "halmet_ads1115.h"
+#include "halmet_profiler.h"
 #include "sensesp/sensors/sensor.h"
 #include "sensesp_base_app.h"
 
@@ -11,14 +13,23 @@ namespace halmet {
 // HALMET voltage divider scale factor
 const float kVoltageDividerScale = 33.3 / 3.3;
 
-sensesp::FloatProducer* ConnectTankSender(Adafruit_ADS1115* ads1115,
-                                          int channel, const String& name,
-                                          const String& sk_id, int sort_order,
-                                          bool enable_signalk_output = true);
-
+sensesp::FloatProducer* ConnectTankSender(
+    ADS1115Sequencer* ads1115, int channel, const String& name,
+    const String& sk_id, int sort_order, bool enable_signalk_output = true,
+    sensesp::FloatProducer** tank_volume = nullptr);
+
+/**
+ * @brief Voltage of an analog input, read through the ADS1115 sequencer.
+ *
+ * The calibration factor and read interval can be changed in the web UI
+ * and take effect immediately. The configuration may be written from the
+ * HTTP server task while samples are processed on the event loop, so the
+ * values are stored atomically and the new interval is handed to the
+ * sequencer from the event loop.
+ */
 class ADS1115VoltageInput : public sensesp::FloatSensor {
  public:
-  ADS1115VoltageInput(Adafruit_ADS1115* ads1115, int channel,
+  ADS1115VoltageInput(ADS1115Sequencer* ads1115, int channel,
                       const String& config_path,
                       unsigned int read_interval = 500,
                       float calibration_factor = 1.0)
@@ -29,53 +40,53 @@ class ADS1115VoltageInput : public sensesp::FloatSensor {
         calibration_factor_{calibration_factor} {
     load();
 
-    repeat_event_ = set_repeat_event(read_interval_);
+    subscription_ = ads1115_->subscribe_auto_gain(
+        channel_, read_interval_,
+        [this](const ADS1115Sample& sample) { this->update(sample); });
   }
 
-  void update() {
-    int16_t adc_output = ads1115_->readADC_SingleEnded(channel_);
-    float adc_output_volts = ads1115_->computeVolts(adc_output);
-    this->emit(calibration_factor_ * kVoltageDividerScale * adc_output_volts);
+  void update(const ADS1115Sample& sample) {
+    this->emit(calibration_factor_.load() * kVoltageDividerScale *
+               sample.volts);
   }
 
   virtual bool to_json(JsonObject& root) override {
-    root["calibration_factor"] = calibration_factor_;
+    root["calibration_factor"] = calibration_factor_.load();
+    root["read_interval"] = read_interval_.load();
     return true;
   };
 
   virtual bool from_json(const JsonObject& config) override {
-    if (config["calibration_factor"].is<float>()) {
-      calibration_factor_ = config["calibration_factor"];
-      return true;
+    if (!config["calibration_factor"].is<float>()) {
+      return false;
     }
-    return false;
-  }
-
- protected:
-  reactesp::RepeatEvent* repeat_event_ = nullptr;
-
-  reactesp::RepeatEvent* set_repeat_event(unsigned int read_interval) {
-    if (repeat_event_ != nullptr) {
-      repeat_event_->remove(sensesp::event_loop());
+    calibration_factor_ = config["calibration_factor"].as<float>();
+    // Optional, for configurations saved before it was added
+    if (config["read_interval"].is<unsigned int>()) {
+      read_interval_ = config["read_interval"].as<unsigned int>();
+      OnDelay("Voltage input interval", 0, [this]() {
+        if (subscription_ >= 0) {
+          ads1115_->set_interval(subscription_, read_interval_);
+        }
+      });
     }
-
-    repeat_event_ = sensesp::event_loop()->onRepeat(
-        read_interval, [this]() { this->update(); });
-    return repeat_event_;
+    return true;
   }
 
  private:
-  Adafruit_ADS1115* ads1115_;
+  ADS1115Sequencer* ads1115_;
   int channel_;
-  unsigned int read_interval_;
-  float calibration_factor_;
+  int subscription_ = -1;
+  std::atomic<unsigned int> read_interval_;
+  std::atomic<float> calibration_factor_;
 };
 
 inline const String ConfigSchema(const ADS1115VoltageInput& obj) {
   const char SCHEMA[] = R"###({
       "type": "object",
       "properties": {
-          "calibration_factor": { "title": "Calibration factor", "type": "number", "description": "Multiplier to apply to the raw input value" }
+          "calibration_factor": { "title": "Calibration factor", "type": "number", "description": "Multiplier to apply to the raw input value" },
+          "read_interval": { "title": "Read interval", "type": "integer", "description": "Time between readings, in milliseconds" }
       }
     })###";
 
@@ -83,7 +94,7 @@ inline const String ConfigSchema(const ADS1115VoltageInput& obj) {
 }
 
 inline const bool ConfigRequiresRestart(const ADS1115VoltageInput& obj) {
-  return true;
+  return false;
 }
 
 }  // namespace halmet
@@ -0,0 +1,90 @@
+#include "halmet_curve.h"
+
+#include <vector>
+
+#include "halmet_profiler.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+static const char* kInterpolationNames[] = {"Linear", "Monotonic cubic"};
+
+CompiledCurveInterpolator::CompiledCurveInterpolator(
+    std::set<Sample>* defaults, const String& config_path)
+    : sensesp::CurveInterpolator(defaults, config_path) {
+  // The base class constructor already loaded the samples, but virtual
+  // dispatch doesn't reach this class from there.
+  load();
+  compile();
+}
+
+void CompiledCurveInterpolator::set(const float& input) {
+  this->emit(curve_.evaluate(input));
+}
+
+void CompiledCurveInterpolator::compile() {
+  std::vector<float> inputs;
+  std::vector<float> outputs;
+  inputs.reserve(samples_.size());
+  outputs.reserve(samples_.size());
+  for (const Sample& sample : samples_) {
+    // The sample set is ordered by input; drop duplicate inputs.
+    if (!inputs.empty() && sample.input_ <= inputs.back()) {
+      continue;
+    }
+    inputs.push_back(sample.input_);
+    outputs.push_back(sample.output_);
+  }
+  curve_.compile(inputs, outputs, interpolation_);
+}
+
+bool CompiledCurveInterpolator::to_json(JsonObject& root) {
+  if (!sensesp::CurveInterpolator::to_json(root)) {
+    return false;
+  }
+  root["interpolation"] = kInterpolationNames[(int)interpolation_];
+  return true;
+}
+
+bool CompiledCurveInterpolator::from_json(const JsonObject& config) {
+  if (!sensesp::CurveInterpolator::from_json(config)) {
+    return false;
+  }
+  // Optional, for configurations saved by CurveInterpolator
+  if (config["interpolation"].is<String>()) {
+    String interpolation = config["interpolation"];
+    interpolation_ = interpolation == kInterpolationNames[1]
+                         ? Interpolation::kMonotonicCubic
+                         : Interpolation::kLinear;
+  }
+  // from_json() may run in the HTTP server task; swap the curve between
+  // samples.
+  OnDelay("Curve compile", 0, [this]() { compile(); });
+  return true;
+}
+
+String CompiledCurveInterpolator::get_config_schema() const {
+  String schema = R"###({
+    "type": "object",
+    "properties": {
+      "interpolation": { "title": "Interpolation", "type": "string", "enum": ["Linear", "Monotonic cubic"], "description": "Monotonic cubic gives a smooth curve through the points without overshooting between them" },
+      "samples": {
+        "title": "Sample values",
+        "type": "array",
+        "format": "table",
+        "items": {
+          "type": "object",
+          "properties": {
+            "input": { "type": "number", "title": "INPUT_TITLE" },
+            "output": { "type": "number", "title": "OUTPUT_TITLE" }
+          }
+        }
+      }
+    }
+  })###";
+  schema.replace("INPUT_TITLE", input_title_);
+  schema.replace("OUTPUT_TITLE", output_title_);
+  return schema;
+}
+
+}  // namespace halmet
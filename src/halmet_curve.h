@@ -0,0 +1,56 @@
+#ifndef HALMET_SRC_HALMET_CURVE_H_
+#define HALMET_SRC_HALMET_CURVE_H_
+
+#include "compiled_curve.h"
+#include "sensesp/transforms/curveinterpolator.h"
+
+namespace halmet {
+
+/**
+ * @brief CurveInterpolator that evaluates a compiled form of its curve.
+ *
+ * Drop-in replacement for sensesp::CurveInterpolator. The sample list is
+ * still edited and stored the same way, but it is compiled into a
+ * CompiledCurve whenever it is loaded or changed, so each input costs the
+ * same regardless of the number of calibration points. Monotonic cubic
+ * interpolation can be selected instead of piecewise linear.
+ *
+ * Edits from the web UI take effect without a restart: the curve is
+ * recompiled on the event loop, so samples in flight are evaluated against
+ * either the old or the new curve, never a partial one.
+ *
+ * add_sample() and clear_samples() are not virtual in the base class; call
+ * compile() after changing the samples in code.
+ */
+class CompiledCurveInterpolator : public sensesp::CurveInterpolator {
+ public:
+  using Interpolation = CompiledCurve::Interpolation;
+
+  CompiledCurveInterpolator(std::set<Sample>* defaults = nullptr,
+                            const String& config_path = "");
+
+  virtual void set(const float& input) override;
+
+  virtual bool to_json(JsonObject& root) override;
+  virtual bool from_json(const JsonObject& config) override;
+
+  void compile();
+
+  String get_config_schema() const;
+
+ protected:
+  Interpolation interpolation_ = Interpolation::kLinear;
+  CompiledCurve curve_;
+};
+
+inline const String ConfigSchema(const CompiledCurveInterpolator& obj) {
+  return obj.get_config_schema();
+}
+
+inline bool ConfigRequiresRestart(const CompiledCurveInterpolator& obj) {
+  return false;
+}
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_CURVE_H_
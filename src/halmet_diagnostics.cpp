@@ -0,0 +1,106 @@
+#include "halmet_diagnostics.h"
+
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+
+#include "halmet_profiler.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+DiagnosticsPage::DiagnosticsPage(DisplayRenderer* display, int page,
+                                 EventLoopStats* loop_stats)
+    : display_{display}, page_{page}, loop_stats_{loop_stats} {
+  last_update_ms_ = millis();
+  OnRepeat("Diagnostics page", 1000, [this]() { update(); });
+}
+
+void DiagnosticsPage::set_nmea2000(tNMEA2000_halmet* nmea2000,
+                                   N2kBusHealthMonitor* health) {
+  nmea2000_ = nmea2000;
+  health_ = health;
+  last_rx_frames_ = nmea2000_->GetRxFrames();
+  last_tx_frames_ = nmea2000_->GetTxFrames();
+}
+
+void DiagnosticsPage::set_gateway_drops(
+    std::function<unsigned long()> gateway_drops) {
+  gateway_drops_ = gateway_drops;
+}
+
+void DiagnosticsPage::set_alarm_manager(AlarmManager* alarm_manager) {
+  alarm_manager_ = alarm_manager;
+}
+
+void DiagnosticsPage::update() {
+  char text[DisplayRenderer::kRowChars + 1];
+  unsigned long now = millis();
+  unsigned long elapsed = now - last_update_ms_;
+  last_update_ms_ = now;
+  if (elapsed == 0) {
+    elapsed = 1;
+  }
+
+  EventLoopStats::Snapshot loop = loop_stats_->take();
+  snprintf(text, sizeof(text), "Loop %lu/s max %.1fms",
+           loop.ticks * 1000 / elapsed, loop.max_tick_us / 1000.0f);
+  display_->set_row(0, text, page_);
+
+  snprintf(text, sizeof(text), "Heap %luk blk %luk",
+           (unsigned long)ESP.getFreeHeap() / 1024,
+           (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT) /
+               1024);
+  display_->set_row(1, text, page_);
+
+  unsigned long tx_lost = 0;
+  unsigned long rx_lost = 0;
+  if (nmea2000_ != nullptr) {
+    unsigned long rx_frames = nmea2000_->GetRxFrames();
+    unsigned long tx_frames = nmea2000_->GetTxFrames();
+    snprintf(text, sizeof(text), "CAN rx %lu tx %lu/s",
+             (rx_frames - last_rx_frames_) * 1000 / elapsed,
+             (tx_frames - last_tx_frames_) * 1000 / elapsed);
+    last_rx_frames_ = rx_frames;
+    last_tx_frames_ = tx_frames;
+    display_->set_row(2, text, page_);
+    tx_lost = nmea2000_->GetDroppedTxFrames();
+  } else {
+    display_->set_row(2, "CAN off", page_);
+  }
+
+  if (health_ != nullptr) {
+    auto stats = health_->get_stats();
+    snprintf(text, sizeof(text), "Err %u/%u %s",
+             stats.error_state.tx_error_counter,
+             stats.error_state.rx_error_counter,
+             N2kBusStateName(health_->get_state()));
+    display_->set_row(3, text, page_);
+    snprintf(text, sizeof(text), "Off %lu arb %lu err %lu",
+             stats.bus_off_count, stats.arb_lost_count,
+             stats.bus_error_count);
+    display_->set_row(4, text, page_);
+    tx_lost += stats.tx_failed_count;
+    rx_lost = stats.rx_missed_count;
+  }
+
+  unsigned long gateway_dropped = gateway_drops_ ? gateway_drops_() : 0;
+  snprintf(text, sizeof(text), "Lost gw %lu tx %lu rx %lu", gateway_dropped,
+           tx_lost, rx_lost);
+  display_->set_row(5, text, page_);
+
+  if (WiFi.status() == WL_CONNECTED) {
+    snprintf(text, sizeof(text), "RSSI %d dBm", WiFi.RSSI());
+  } else {
+    snprintf(text, sizeof(text), "WiFi disconnected");
+  }
+  display_->set_row(6, text, page_);
+
+  if (alarm_manager_ != nullptr) {
+    auto stats = alarm_manager_->get_stats();
+    snprintf(text, sizeof(text), "Alm lat %.1f max %.1f",
+             stats.last_latency_us / 1000.0f, stats.max_latency_us / 1000.0f);
+    display_->set_row(7, text, page_);
+  }
+}
+
+}  // namespace halmet
@@ -0,0 +1,90 @@
+#ifndef HALMET_SRC_HALMET_DIAGNOSTICS_H_
+#define HALMET_SRC_HALMET_DIAGNOSTICS_H_
+
+#include <functional>
+
+#include "halmet_alarm_manager.h"
+#include "halmet_display.h"
+#include "halmet_n2k_bus.h"
+#include "halmet_n2k_health.h"
+
+namespace halmet {
+
+/**
+ * @brief Event loop tick counter.
+ *
+ * record() is called around every event loop tick, so it only counts and
+ * keeps the maximum. Only access it on the event loop.
+ */
+class EventLoopStats {
+ public:
+  struct Snapshot {
+    unsigned long ticks = 0;
+    unsigned long max_tick_us = 0;
+  };
+
+  void record(unsigned long tick_us) {
+    ticks_++;
+    if (tick_us > max_tick_us_) {
+      max_tick_us_ = tick_us;
+    }
+  }
+
+  /// Counts since the previous call
+  Snapshot take() {
+    Snapshot snapshot;
+    snapshot.ticks = ticks_;
+    snapshot.max_tick_us = max_tick_us_;
+    ticks_ = 0;
+    max_tick_us_ = 0;
+    return snapshot;
+  }
+
+ protected:
+  unsigned long ticks_ = 0;
+  unsigned long max_tick_us_ = 0;
+};
+
+/**
+ * @brief Display page with system health figures.
+ *
+ * Shows the event loop tick rate and worst tick, free heap and largest free
+ * block, CAN frame rates, error counters and bus events (bus-off,
+ * arbitration lost, bus errors), lost messages, the Wi-Fi signal strength
+ * and the alarm propagation latency, in ms. Lost TX frames are those
+ * dropped during bus-off plus those the controller failed to send. The
+ * figures come from counters maintained in the hot paths and are turned
+ * into rates once per second, so a frozen gauge can be diagnosed on board
+ * without a laptop.
+ */
+class DiagnosticsPage {
+ public:
+  DiagnosticsPage(DisplayRenderer* display, int page,
+                  EventLoopStats* loop_stats);
+
+  void set_nmea2000(tNMEA2000_halmet* nmea2000, N2kBusHealthMonitor* health);
+
+  /// Set the source of the gateway's dropped message count.
+  void set_gateway_drops(std::function<unsigned long()> gateway_drops);
+
+  void set_alarm_manager(AlarmManager* alarm_manager);
+
+ protected:
+  void update();
+
+  DisplayRenderer* display_;
+  int page_;
+  EventLoopStats* loop_stats_;
+  tNMEA2000_halmet* nmea2000_ = nullptr;
+  N2kBusHealthMonitor* health_ = nullptr;
+  std::function<unsigned long()> gateway_drops_;
+  AlarmManager* alarm_manager_ = nullptr;
+
+  unsigned long last_update_ms_;
+  unsigned long last_rx_frames_ = 0;
+  unsigned long last_tx_frames_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_DIAGNOSTICS_H_
@@ -1,29 +1,39 @@
 #include "halmet_digital.h"
 
+#include "halmet_alarm_input.h"
+#include "halmet_tacho.h"
 #include "sensesp/sensors/digital_input.h"
 #include "sensesp/sensors/sensor.h"
 #include "sensesp/signalk/signalk_output.h"
-#include "sensesp/transforms/frequency.h"
 #include "sensesp/ui/config_item.h"
 
 using namespace sensesp;
+using namespace halmet;
 
 // Default RPM count scale factor, corresponds to 100 pulses per revolution.
 // This is rarely, if ever correct.
 const float kDefaultFrequencyScale = 1 / 100.;
 
-FloatProducer* ConnectTachoSender(int pin, String name) {
+// Tacho output interval, in ms. Matches the PGN 127488 transmission rate.
+const unsigned int kTachoOutputInterval = 100;
+
+FrequencyScale* ConnectTachoSender(int pin, String name,
+                                   PulseCounterType counter_type) {
   char config_path[80];
   char sk_path[80];
   char config_title[80];
   char config_description[80];
 
+  // Same path as the DigitalInputCounter this input replaced, so existing
+  // installs keep their configuration entry. The counter only saved its
+  // read delay, which has no equivalent here; TachoInput::from_json()
+  // rejects that file and the defaults apply until the next save.
   snprintf(config_path, sizeof(config_path), "/Tacho %s/Pin", name.c_str());
-  snprintf(config_title, sizeof(config_title), "Tacho %s Pin", name.c_str());
-  snprintf(config_description, sizeof(config_description), "Tacho %s Input Pin",
-           name.c_str());
-  auto tacho_input =
-      new DigitalInputCounter(pin, INPUT, RISING, 500, config_path);
+  snprintf(config_title, sizeof(config_title), "Tacho %s Input", name.c_str());
+  snprintf(config_description, sizeof(config_description),
+           "Tacho %s pulse period measurement", name.c_str());
+  auto tacho_input = new TachoInput(CreatePulseCounter(counter_type, pin),
+                                    kTachoOutputInterval, config_path);
 
   ConfigItem(tacho_input)
       ->set_title(config_title)
@@ -35,12 +45,14 @@ FloatProducer* ConnectTachoSender(int pin, String name) {
            name.c_str());
   snprintf(config_description, sizeof(config_description),
            "Tacho %s Multiplier", name.c_str());
-  auto tacho_frequency = new Frequency(kDefaultFrequencyScale, config_path);
+  auto tacho_frequency =
+      new FrequencyScale(kDefaultFrequencyScale, config_path);
 
   ConfigItem(tacho_frequency)
       ->set_title(config_title)
       ->set_description(config_description);
 
+  tacho_input->set_frequency_scale(tacho_frequency);
   tacho_input->connect_to(tacho_frequency);
 
 #ifdef ENABLE_SIGNALK
@@ -64,21 +76,41 @@ FloatProducer* ConnectTachoSender(int pin, String name) {
   return tacho_frequency;
 }
 
-BoolProducer* ConnectAlarmSender(int pin, String name) {
+AlarmInput* ConnectAlarmSender(int pin, String name) {
   char config_path[80];
-  char sk_path[80];
   char config_title[80];
   char config_description[80];
 
-  auto* alarm_input = new DigitalInputState(pin, INPUT, 100);
+  snprintf(config_path, sizeof(config_path), "/Alarm %s/Input", name.c_str());
+  snprintf(config_title, sizeof(config_title), "Alarm %s Input", name.c_str());
+  snprintf(config_description, sizeof(config_description),
+           "Alarm %s input debouncing", name.c_str());
+  auto* alarm_input = new AlarmInput(pin, config_path);
+
+  ConfigItem(alarm_input)
+      ->set_title(config_title)
+      ->set_description(config_description);
+
+  // The alarm state is published to Signal K by ConnectAlarmOutput() and
+  // as a notification by the alarm manager.
+
+  return alarm_input;
+}
 
+void ConnectAlarmOutput(Alarm* alarm) {
 #ifdef ENABLE_SIGNALK
-  snprintf(config_path, sizeof(config_path), "/Alarm %s/SK Path", name.c_str());
-  snprintf(sk_path, sizeof(sk_path), "alarm.%s", name.c_str());
+  char config_path[80];
+  char sk_path[80];
+  char config_title[80];
+  char config_description[80];
+  const char* name = alarm->get_name().c_str();
+
+  snprintf(config_path, sizeof(config_path), "/Alarm %s/SK Path", name);
+  snprintf(sk_path, sizeof(sk_path), "alarm.%s", name);
   snprintf(config_title, sizeof(config_title), "Alarm %s Signal K Path",
-           name.c_str());
+           name);
   snprintf(config_description, sizeof(config_description),
-           "Alarm %s Signal K Path", name.c_str());
+           "Alarm %s Signal K Path", name);
 
   auto alarm_sk_output = new SKOutputBool(sk_path, config_path);
 
@@ -86,8 +118,8 @@ BoolProducer* ConnectAlarmSender(int pin, String name) {
       ->set_title(config_title)
       ->set_description(config_description);
 
-  alarm_input->connect_to(alarm_sk_output);
+  // The alarm only emits on changes; start from its current state.
+  alarm_sk_output->set(alarm->is_active());
+  alarm->connect_to(alarm_sk_output);
 #endif
-
-  return alarm_input;
 }
@@ -1,11 +1,19 @@
 #ifndef __SRC_HALMET_DIGITAL_H__
 #define __SRC_HALMET_DIGITAL_H__
 
+#include "halmet_alarm_input.h"
+#include "halmet_alarm_manager.h"
+#include "halmet_pulse_counter.h"
+#include "halmet_tacho.h"
 #include "sensesp/sensors/sensor.h"
 
 using namespace sensesp;
 
-FloatProducer* ConnectTachoSender(int pin, String name);
-BoolProducer* ConnectAlarmSender(int pin, String name);
+halmet::FrequencyScale* ConnectTachoSender(
+    int pin, String name,
+    halmet::PulseCounterType counter_type =
+        halmet::PulseCounterType::kInterrupt);
+halmet::AlarmInput* ConnectAlarmSender(int pin, String name);
+void ConnectAlarmOutput(halmet::Alarm* alarm);
 
 #endif
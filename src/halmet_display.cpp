@@ -2,6 +2,9 @@
 #include "halmet_display.h"
 
 #include <WiFi.h>
+#include <cstring>
+
+#include "halmet_profiler.h"
 
 namespace halmet {
 
@@ -9,44 +12,269 @@ namespace halmet {
 const int kScreenWidth = 128;
 const int kScreenHeight = 64;
 
-bool InitializeSSD1306(const std::shared_ptr<sensesp::SensESPBaseApp> sensesp_app,
-                       Adafruit_SSD1306** display, TwoWire* i2c) {
-  *display = new Adafruit_SSD1306(kScreenWidth, kScreenHeight, i2c, -1);
-  bool init_successful = (*display)->begin(SSD1306_SWITCHCAPVCC, 0x3C);
-  if (!init_successful) {
-    debugD("SSD1306 allocation failed");
+const uint8_t kSSD1306Address = 0x3C;
+
+// Page button polling interval, in ms. Two equal consecutive readings make
+// a debounced state.
+const unsigned int kPageButtonPollInterval = 20;
+
+// Longest press that selects the next page, in ms. Longer presses belong to
+// SensESP's button handler. Same limit as its short press.
+const unsigned long kPageButtonMaxPress = 1000;
+
+DisplayRenderer::DisplayRenderer(Adafruit_SSD1306* display, I2CScheduler* i2c,
+                                 String config_path, BaseType_t core,
+                                 UBaseType_t priority)
+    : sensesp::FileSystemSaveable{config_path}, display_{display}, i2c_{i2c} {
+  load();
+
+  i2c_client_ = i2c_->add_client("Display", I2CScheduler::Priority::kLow);
+  frame_mutex_ = xSemaphoreCreateMutex();
+
+  display_->setTextWrap(false);
+
+  // Start sending a frame once the renderer has published it. A transfer
+  // in progress picks up the new frame by itself.
+  OnTick("Display frame", [this]() {
+    if (frame_ready_.exchange(false) && !i2c_->is_pending(i2c_client_)) {
+      i2c_->submit(i2c_client_, [this]() { return send_slice(); });
+    }
+  });
+
+  OnRepeat("Display page cycle", 1000, [this]() {
+    unsigned int page_interval = page_interval_;
+    if (page_interval > 0 && ++seconds_on_page_ >= page_interval) {
+      next_page();
+    }
+  });
+
+  xTaskCreatePinnedToCore(task_entry, "display", 3072, this, priority, &task_,
+                          core);
+}
+
+void DisplayRenderer::set_row(int row, const char* text, int page) {
+  if (row < 0 || row >= kRows || page < 0 || page >= kPages) {
+    return;
+  }
+  bool changed = false;
+  portENTER_CRITICAL(&rows_mux_);
+  if (strncmp(rows_[page][row], text, kRowChars) != 0) {
+    strncpy(rows_[page][row], text, kRowChars);
+    if (page == active_page_) {
+      dirty_rows_ |= 1UL << row;
+      changed = true;
+    }
+  }
+  portEXIT_CRITICAL(&rows_mux_);
+
+  if (changed && task_ != nullptr) {
+    xTaskNotifyGive(task_);
+  }
+}
+
+void DisplayRenderer::set_page(int page) {
+  if (page < 0 || page >= kPages) {
+    return;
+  }
+  portENTER_CRITICAL(&rows_mux_);
+  active_page_ = page;
+  dirty_rows_ = (1UL << kRows) - 1;
+  portEXIT_CRITICAL(&rows_mux_);
+  seconds_on_page_ = 0;
+
+  if (task_ != nullptr) {
+    xTaskNotifyGive(task_);
+  }
+}
+
+void DisplayRenderer::next_page() { set_page((get_page() + 1) % kPages); }
+
+int DisplayRenderer::get_page() {
+  portENTER_CRITICAL(&rows_mux_);
+  int page = active_page_;
+  portEXIT_CRITICAL(&rows_mux_);
+  return page;
+}
+
+void DisplayRenderer::attach_page_button(int pin) {
+  pinMode(pin, INPUT_PULLUP);
+  OnRepeat("Display button", kPageButtonPollInterval, [this, pin]() {
+    bool reading = digitalRead(pin) == LOW;
+    if (reading == button_reading_ && reading != button_pressed_) {
+      button_pressed_ = reading;
+      unsigned long now = millis();
+      if (button_pressed_) {
+        button_press_time_ = now;
+      } else if (now - button_press_time_ < kPageButtonMaxPress) {
+        next_page();
+      }
+    }
+    button_reading_ = reading;
+  });
+}
+
+void DisplayRenderer::task_entry(void* arg) {
+  static_cast<DisplayRenderer*>(arg)->run();
+}
+
+void DisplayRenderer::run() {
+  while (true) {
+    // Sleep until a row changes, then hold off for the rest of the frame so
+    // that further changes are drawn together with the next render.
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    render();
+    float frame_rate = frame_rate_;
+    TickType_t frame_interval =
+        pdMS_TO_TICKS(frame_rate > 0 ? 1000 / frame_rate : 1000);
+    vTaskDelay(frame_interval > 0 ? frame_interval : 1);
+  }
+}
+
+void DisplayRenderer::render() {
+  char rows[kRows][kRowChars + 1];
+  portENTER_CRITICAL(&rows_mux_);
+  uint32_t dirty_rows = dirty_rows_;
+  dirty_rows_ = 0;
+  memcpy(rows, rows_[active_page_], sizeof(rows));
+  portEXIT_CRITICAL(&rows_mux_);
+
+  if (dirty_rows == 0) {
+    return;
+  }
+
+  // The Adafruit_SSD1306 framebuffer serves as the back buffer; only this
+  // task draws into it.
+  for (int row = 0; row < kRows; row++) {
+    if (dirty_rows & (1UL << row)) {
+      display_->fillRect(0, 8 * row, kScreenWidth, 8, 0);
+      display_->setCursor(0, 8 * row);
+      display_->print(rows[row]);
+    }
+  }
+
+  xSemaphoreTake(frame_mutex_, portMAX_DELAY);
+  memcpy(frame_, display_->getBuffer(), kBufferSize);
+  xSemaphoreGive(frame_mutex_);
+  frame_ready_ = true;
+}
+
+/// Send the next changed slice of the frame using SSD1306 page and column
+/// addressing. Returns false when the display is up to date.
+bool DisplayRenderer::send_slice() {
+  uint8_t data[kSliceSize];
+  int slice = -1;
+
+  xSemaphoreTake(frame_mutex_, portMAX_DELAY);
+  for (int i = 0; i < kSlices; i++) {
+    int candidate = (next_slice_ + i) % kSlices;
+    int offset = candidate * kSliceSize;
+    if ((unsent_slices_ & (1UL << candidate)) ||
+        memcmp(frame_ + offset, sent_ + offset, kSliceSize) != 0) {
+      slice = candidate;
+      memcpy(data, frame_ + offset, kSliceSize);
+      break;
+    }
+  }
+  xSemaphoreGive(frame_mutex_);
+
+  if (slice == -1) {
     return false;
   }
-  delay(100);
-  (*display)->setRotation(2);
-  (*display)->clearDisplay();
-  (*display)->setTextSize(1);
-  (*display)->setTextColor(SSD1306_WHITE);
-  (*display)->setCursor(0, 0);
-  (*display)->printf("Host: %s\n", sensesp_app->get_hostname().c_str());
-  (*display)->display();
 
+  const int slices_per_page = kScreenWidth / kSliceSize;
+  int page = slice / slices_per_page;
+  int column = (slice % slices_per_page) * kSliceSize;
+
+  TwoWire* wire = i2c_->get_bus();
+  wire->beginTransmission(kSSD1306Address);
+  wire->write((uint8_t)0x00);  // Command stream
+  wire->write((uint8_t)SSD1306_PAGEADDR);
+  wire->write((uint8_t)page);
+  wire->write((uint8_t)page);
+  wire->write((uint8_t)SSD1306_COLUMNADDR);
+  wire->write((uint8_t)column);
+  wire->write((uint8_t)(column + kSliceSize - 1));
+  wire->endTransmission();
+
+  wire->beginTransmission(kSSD1306Address);
+  wire->write((uint8_t)0x40);  // Data stream
+  wire->write(data, kSliceSize);
+  wire->endTransmission();
+
+  memcpy(sent_ + slice * kSliceSize, data, kSliceSize);
+  unsent_slices_ &= ~(1UL << slice);
+  next_slice_ = (slice + 1) % kSlices;
   return true;
 }
 
-/// Clear a text row on an Adafruit graphics display
-void ClearRow(Adafruit_SSD1306* display, int row) {
-  display->fillRect(0, 8 * row, kScreenWidth, 8, 0);
+bool DisplayRenderer::to_json(JsonObject& root) {
+  root["frame_rate"] = (float)frame_rate_;
+  root["page_interval"] = (unsigned int)page_interval_;
+  return true;
+}
+
+bool DisplayRenderer::from_json(const JsonObject& config) {
+  if (!config["frame_rate"].is<float>()) {
+    return false;
+  }
+  // Read by the renderer task before each frame interval
+  frame_rate_ = config["frame_rate"].as<float>();
+  // Optional; older configurations don't have it
+  if (config["page_interval"].is<unsigned int>()) {
+    page_interval_ = config["page_interval"].as<unsigned int>();
+  }
+  return true;
+}
+
+const String ConfigSchema(const DisplayRenderer& obj) {
+  return R"###({
+    "type": "object",
+    "properties": {
+      "frame_rate": { "title": "Frame rate", "type": "number", "minimum": 0.1, "maximum": 30, "description": "Maximum number of display updates per second. Value changes within one frame are shown together." },
+      "page_interval": { "title": "Page interval", "type": "integer", "minimum": 0, "description": "Time to show each display page before switching to the next, in seconds. 0 switches pages only on a button press." }
+    }
+  })###";
+}
+
+DisplayRenderer* InitializeSSD1306(
+    const std::shared_ptr<sensesp::SensESPBaseApp> sensesp_app,
+    I2CScheduler* i2c) {
+  auto display =
+      new Adafruit_SSD1306(kScreenWidth, kScreenHeight, i2c->get_bus(), -1);
+  // Runs once, before the event loop starts sharing the bus
+  bool init_successful = display->begin(SSD1306_SWITCHCAPVCC, kSSD1306Address);
+  if (!init_successful) {
+    debugD("SSD1306 allocation failed");
+    delete display;
+    return nullptr;
+  }
+  delay(100);
+  display->setRotation(2);
+  display->clearDisplay();
+  display->setTextSize(1);
+  display->setTextColor(SSD1306_WHITE);
+
+  auto renderer = new DisplayRenderer(display, i2c, "/System/Display");
+
+  char host_string[DisplayRenderer::kRowChars + 1];
+  snprintf(host_string, sizeof(host_string), "Host: %s",
+           sensesp_app->get_hostname().c_str());
+  renderer->set_row(0, host_string);
+
+  return renderer;
 }
 
-void PrintValue(Adafruit_SSD1306* display, int row, String title, float value) {
-  ClearRow(display, row);
-  display->setCursor(0, 8 * row);
-  display->printf("%s: %.1f", title.c_str(), value);
-  display->display();
+void PrintValue(DisplayRenderer* display, int row, String title, float value) {
+  char text[DisplayRenderer::kRowChars + 1];
+  snprintf(text, sizeof(text), "%s: %.1f", title.c_str(), value);
+  display->set_row(row, text);
 }
 
-void PrintValue(Adafruit_SSD1306* display, int row, String title,
+void PrintValue(DisplayRenderer* display, int row, String title,
                 String value) {
-  ClearRow(display, row);
-  display->setCursor(0, 8 * row);
-  display->printf("%s: %s", title.c_str(), value.c_str());
-  display->display();
+  char text[DisplayRenderer::kRowChars + 1];
+  snprintf(text, sizeof(text), "%s: %s", title.c_str(), value.c_str());
+  display->set_row(row, text);
 }
 
 }  // namespace halmet
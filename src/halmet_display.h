@@ -4,17 +4,112 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 
+#include <atomic>
+
+#include "halmet_i2c.h"
+#include "sensesp/system/saveable.h"
 #include "sensesp_base_app.h"
 
 namespace halmet {
 
-bool InitializeSSD1306(const std::shared_ptr<sensesp::SensESPBaseApp> sensesp_app,
-                       Adafruit_SSD1306** display, TwoWire* i2c);
+/**
+ * @brief Text display model and renderer for the SSD1306 OLED.
+ *
+ * Producers set the text of a row with set_row(), which only updates a
+ * small table and is safe to call from any task. A low-priority FreeRTOS
+ * task draws the changed rows into the framebuffer, at most once per frame,
+ * and publishes the finished frame. Value changes arriving within one frame
+ * are coalesced into a single render.
+ *
+ * The event loop only sends the slices of the published frame that differ
+ * from what the display already shows, through the I2C scheduler.
+ *
+ * The display has several pages of rows, one shown at a time. Rows on
+ * hidden pages can be set at any time and are drawn when their page is
+ * selected, either with a button or by cycling on a timer.
+ *
+ * The frame rate and page interval can be changed without a restart.
+ */
+class DisplayRenderer : public sensesp::FileSystemSaveable {
+ public:
+  static const int kRows = 8;
+  // 128 px wide, 6 px per character at text size 1
+  static const int kRowChars = 21;
+  static const int kPages = 2;
+
+  DisplayRenderer(Adafruit_SSD1306* display, I2CScheduler* i2c,
+                  String config_path = "", BaseType_t core = 0,
+                  UBaseType_t priority = 1);
+
+  /// Set the text of a row. Does nothing if the row already shows the text.
+  void set_row(int row, const char* text, int page = 0);
+
+  void set_page(int page);
+  void next_page();
+  int get_page();
+
+  /// Select the next page when the active-low button on the pin is
+  /// released after a short press. Long presses are ignored.
+  void attach_page_button(int pin);
+
+  virtual bool to_json(JsonObject& root) override;
+  virtual bool from_json(const JsonObject& config) override;
+
+ protected:
+  static const int kBufferSize = 128 * 64 / 8;
+  static const int kSliceSize = 64;
+  static const int kSlices = kBufferSize / kSliceSize;
+
+  static void task_entry(void* arg);
+  void run();
+  void render();
+  bool send_slice();
+
+  Adafruit_SSD1306* display_;
+  I2CScheduler* i2c_;
+  int i2c_client_;
+  TaskHandle_t task_ = nullptr;
+
+  std::atomic<float> frame_rate_{5};            // Hz
+  std::atomic<unsigned int> page_interval_{0};  // s, 0 disables cycling
+  unsigned int seconds_on_page_ = 0;
+  bool button_reading_ = false;
+  bool button_pressed_ = false;
+  unsigned long button_press_time_ = 0;
+
+  // Row table, written by the producers and read by the renderer task.
+  // Dirty flags only cover the active page.
+  portMUX_TYPE rows_mux_ = portMUX_INITIALIZER_UNLOCKED;
+  char rows_[kPages][kRows][kRowChars + 1] = {};
+  int active_page_ = 0;
+  uint32_t dirty_rows_ = 0;
+
+  // Last rendered frame, written by the renderer task and read by the
+  // event loop
+  SemaphoreHandle_t frame_mutex_;
+  uint8_t frame_[kBufferSize] = {};
+  std::atomic<bool> frame_ready_{false};
+
+  // Display RAM contents as last sent; only accessed on the event loop
+  uint8_t sent_[kBufferSize];
+  // Slices whose display RAM contents are unknown, initially all of them
+  uint32_t unsent_slices_ = (1UL << kSlices) - 1;
+  int next_slice_ = 0;
+};
+
+const String ConfigSchema(const DisplayRenderer& obj);
+
+inline bool ConfigRequiresRestart(const DisplayRenderer& obj) {
+  return false;
+}
 
-void ClearRow(Adafruit_SSD1306* display, int row);
+/// Initialize the display. Returns nullptr if no display is present.
+DisplayRenderer* InitializeSSD1306(
+    const std::shared_ptr<sensesp::SensESPBaseApp> sensesp_app,
+    I2CScheduler* i2c);
 
-void PrintValue(Adafruit_SSD1306* display, int row, String title, float value);
-void PrintValue(Adafruit_SSD1306* display, int row, String title, String value);
+void PrintValue(DisplayRenderer* display, int row, String title, float value);
+void PrintValue(DisplayRenderer* display, int row, String title, String value);
 
 }  // namespace halmet
 
@@ -0,0 +1,207 @@
+#include "halmet_engine_hours.h"
+
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include <nvs.h>
+
+#include <algorithm>
+#include <cstddef>
+
+#include "halmet_profiler.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+const char* kEngineHoursNvsNamespace = "engine_hours";
+
+// Engine speed older than this is ignored, in ms
+const unsigned long kEngineSpeedExpiry = 5000;
+
+// Kept over all resets except power loss. Contents are garbage after power
+// up, which the CRC rejects.
+const int kRtcRecords = 4;
+RTC_NOINIT_ATTR EngineHoursRecord rtc_engine_hours[kRtcRecords];
+
+static uint32_t RecordCrc(const EngineHoursRecord& record) {
+  return esp_rom_crc32_le(0, (const uint8_t*)&record,
+                          offsetof(EngineHoursRecord, crc));
+}
+
+static bool IsValid(const EngineHoursRecord& record, uint32_t key) {
+  return record.key == key && record.crc == RecordCrc(record);
+}
+
+EngineHoursAccumulator::EngineHoursAccumulator(String name, String config_path)
+    : sensesp::Sensor<uint32_t>(config_path), engine_speed_{0}, name_{name} {
+  load();
+  key_ = esp_rom_crc32_le(0, (const uint8_t*)name_.c_str(), name_.length());
+  restore();
+  last_update_ms_ = millis();
+  last_checkpoint_ms_ = last_update_ms_;
+
+  engine_speed_.attach([this]() {
+    engine_speed_connected_ = true;
+    engine_speed_time_ = millis();
+  });
+
+  OnRepeat("Engine hours", 1000, [this]() { update(); });
+}
+
+void EngineHoursAccumulator::restore() {
+  nvs_handle_t handle;
+  if (nvs_open(kEngineHoursNvsNamespace, NVS_READONLY, &handle) == ESP_OK) {
+    EngineHoursRecord record;
+    size_t size = sizeof(record);
+    if (nvs_get_blob(handle, name_.c_str(), &record, &size) == ESP_OK &&
+        size == sizeof(record) && IsValid(record, key_)) {
+      seconds_ = record.seconds;
+      sequence_ = record.sequence;
+    }
+    nvs_close(handle);
+  }
+  saved_seconds_ = seconds_;
+
+  // The RTC copy is newer unless the power was lost
+  rtc_record_ = find_rtc_record();
+  if (rtc_record_ != nullptr && IsValid(*rtc_record_, key_) &&
+      rtc_record_->seconds > seconds_) {
+    debugD("Engine hours %s: %lu s not checkpointed before reset",
+           name_.c_str(), (unsigned long)(rtc_record_->seconds - seconds_));
+    seconds_ = rtc_record_->seconds;
+    sequence_ = std::max(sequence_, rtc_record_->sequence);
+  }
+  if (rtc_record_ != nullptr) {
+    *rtc_record_ = make_record();
+  }
+}
+
+EngineHoursRecord* EngineHoursAccumulator::find_rtc_record() {
+  for (int i = 0; i < kRtcRecords; i++) {
+    if (IsValid(rtc_engine_hours[i], key_)) {
+      return &rtc_engine_hours[i];
+    }
+  }
+  // Take a slot not used by another accumulator
+  for (int i = 0; i < kRtcRecords; i++) {
+    if (rtc_engine_hours[i].crc != RecordCrc(rtc_engine_hours[i])) {
+      return &rtc_engine_hours[i];
+    }
+  }
+  return nullptr;
+}
+
+EngineHoursRecord EngineHoursAccumulator::make_record() {
+  EngineHoursRecord record;
+  record.key = key_;
+  record.sequence = sequence_;
+  record.seconds = seconds_;
+  record.crc = RecordCrc(record);
+  return record;
+}
+
+bool EngineHoursAccumulator::is_running() {
+  return engine_speed_connected_ &&
+         millis() - engine_speed_time_ < kEngineSpeedExpiry &&
+         60 * engine_speed_.get() >= running_rpm_;
+}
+
+void EngineHoursAccumulator::update() {
+  unsigned long now = millis();
+  unsigned long elapsed = now - last_update_ms_;
+  last_update_ms_ = now;
+
+  bool running = is_running();
+  if (running && !running_) {
+    // Count the checkpoint interval from the engine start
+    last_checkpoint_ms_ = now;
+  }
+  if (running) {
+    remainder_ms_ += elapsed;
+    seconds_ += remainder_ms_ / 1000;
+    remainder_ms_ %= 1000;
+  }
+
+  if (running_ && !running) {
+    // The engine stopped; the power may go next
+    checkpoint();
+  } else if (running && now - last_checkpoint_ms_ >=
+                            checkpoint_interval_ * 60 * 1000UL) {
+    checkpoint();
+  }
+  running_ = running;
+
+  if (rtc_record_ != nullptr) {
+    *rtc_record_ = make_record();
+  }
+  this->emit(seconds_);
+}
+
+void EngineHoursAccumulator::checkpoint() {
+  last_checkpoint_ms_ = millis();
+  if (seconds_ == saved_seconds_) {
+    return;
+  }
+
+  sequence_++;
+  EngineHoursRecord record = make_record();
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(kEngineHoursNvsNamespace, NVS_READWRITE, &handle);
+  if (err == ESP_OK) {
+    err = nvs_set_blob(handle, name_.c_str(), &record, sizeof(record));
+    if (err == ESP_OK) {
+      err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+  }
+  if (err != ESP_OK) {
+    debugW("Engine hours %s checkpoint failed: %s", name_.c_str(),
+           esp_err_to_name(err));
+    return;
+  }
+  saved_seconds_ = seconds_;
+  debugD("Engine hours %s checkpoint %lu: %lu s", name_.c_str(),
+         (unsigned long)sequence_, (unsigned long)seconds_);
+}
+
+bool EngineHoursAccumulator::to_json(JsonObject& root) {
+  root["running_rpm"] = (float)running_rpm_;
+  root["checkpoint_interval"] = (unsigned int)checkpoint_interval_;
+  root["hours"] = seconds_ / 3600.0f;
+  return true;
+}
+
+bool EngineHoursAccumulator::from_json(const JsonObject& config) {
+  if (!config["running_rpm"].is<float>() ||
+      !config["checkpoint_interval"].is<unsigned int>()) {
+    return false;
+  }
+  running_rpm_ = config["running_rpm"].as<float>();
+  checkpoint_interval_ =
+      std::max(config["checkpoint_interval"].as<unsigned int>(), 1U);
+
+  // Only present when entered in the web UI; never saved
+  if (config["set_hours"].is<float>()) {
+    float hours = config["set_hours"].as<float>();
+    OnDelay("Engine hours set", 0, [this, hours]() {
+      seconds_ = hours * 3600;
+      remainder_ms_ = 0;
+      checkpoint();
+      this->emit(seconds_);
+    });
+  }
+  return true;
+}
+
+const String ConfigSchema(const EngineHoursAccumulator& obj) {
+  return R"###({
+    "type": "object",
+    "properties": {
+      "hours": { "title": "Engine hours", "type": "number", "readOnly": true },
+      "set_hours": { "title": "Set engine hours", "type": "number", "minimum": 0, "description": "Enter a value to set the engine hours, e.g. to match a previous hour meter. Leave empty to keep counting." },
+      "running_rpm": { "title": "Running speed", "type": "number", "minimum": 0, "description": "Engine speed above which running time is counted, in RPM" },
+      "checkpoint_interval": { "title": "Checkpoint interval", "type": "integer", "minimum": 1, "description": "Interval between saves to flash while the engine runs, in minutes. The engine hours are also saved when the engine stops." }
+    }
+  })###";
+}
+
+}  // namespace halmet
@@ -0,0 +1,94 @@
+#ifndef HALMET_SRC_HALMET_ENGINE_HOURS_H_
+#define HALMET_SRC_HALMET_ENGINE_HOURS_H_
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "sensesp/sensors/sensor.h"
+#include "sensesp/system/observablevalue.h"
+
+namespace halmet {
+
+/// Persisted engine hours state
+struct EngineHoursRecord {
+  uint32_t key;       // Identifies the accumulator
+  uint32_t sequence;  // Incremented on every checkpoint
+  uint32_t seconds;   // Total running time
+  uint32_t crc;       // CRC-32 of the fields above
+};
+
+/**
+ * @brief Engine hour meter driven by the tacho.
+ *
+ * Time counts while engine_speed_ (in Hz) is above the running speed. The
+ * output is the total running time in seconds, emitted every second, as
+ * used by Signal K runTime and PGN 127489.
+ *
+ * The total is kept in RAM and mirrored every second into RTC memory,
+ * which survives brownout and watchdog resets, crashes and restarts. Flash
+ * only receives a checkpoint every checkpoint interval while running and
+ * when the engine stops, which is when the power is usually switched off.
+ * A full power loss loses at most the time since the last checkpoint.
+ *
+ * Checkpoints are small NVS records with a sequence number and CRC. NVS
+ * appends every write to its log-structured pages and spreads erases over
+ * the whole partition, so even a one-minute interval of continuous running
+ * stays far within the flash endurance. A record that fails its CRC is
+ * ignored.
+ */
+class EngineHoursAccumulator : public sensesp::Sensor<uint32_t> {
+ public:
+  /**
+   * @param name Engine name, used as the storage key (at most 15 characters)
+   * @param config_path Configuration path
+   */
+  EngineHoursAccumulator(String name, String config_path = "");
+
+  uint32_t get_seconds() const { return seconds_; }
+
+  /// Write the total to flash if it changed since the last checkpoint.
+  void checkpoint();
+
+  virtual bool to_json(JsonObject& root) override;
+  virtual bool from_json(const JsonObject& config) override;
+
+  // Engine speed input, in Hz
+  sensesp::ObservableValue<float> engine_speed_;
+
+ protected:
+  void restore();
+  void update();
+  bool is_running();
+  EngineHoursRecord make_record();
+  EngineHoursRecord* find_rtc_record();
+
+  String name_;
+  uint32_t key_;
+
+  // Settings
+  std::atomic<float> running_rpm_{300};
+  std::atomic<unsigned int> checkpoint_interval_{10};  // min
+
+  // State; only accessed on the event loop
+  uint32_t seconds_ = 0;
+  unsigned long remainder_ms_ = 0;
+  uint32_t sequence_ = 0;
+  uint32_t saved_seconds_ = 0;
+  unsigned long last_update_ms_;
+  unsigned long last_checkpoint_ms_;
+  bool running_ = false;
+  bool engine_speed_connected_ = false;
+  unsigned long engine_speed_time_ = 0;
+  EngineHoursRecord* rtc_record_ = nullptr;
+};
+
+const String ConfigSchema(const EngineHoursAccumulator& obj);
+
+inline bool ConfigRequiresRestart(const EngineHoursAccumulator& obj) {
+  return false;
+}
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_ENGINE_HOURS_H_
@@ -0,0 +1,81 @@
+#include "halmet_fuel_rate.h"
+
+namespace halmet {
+
+// Engine speed below which the engine is considered stopped, in Hz
+const float kEngineStoppedSpeed = 0.5;
+
+// Engine speed older than this is ignored, in ms
+const unsigned long kEngineSpeedExpiry = 5000;
+
+const float kLitersPerCubicMeter = 1000;
+const float kSecondsPerHour = 3600;
+
+FuelRateEstimator::FuelRateEstimator(String config_path)
+    : sensesp::FloatTransform(config_path), engine_speed_{0} {
+  load();
+  filter_.configure(volume_noise_, rate_noise_ * rate_noise_ * 60,
+                    refuel_threshold_);
+
+  engine_speed_.attach([this]() {
+    engine_speed_connected_ = true;
+    engine_speed_time_ = millis();
+  });
+}
+
+bool FuelRateEstimator::is_engine_stopped() {
+  return engine_speed_connected_ &&
+         millis() - engine_speed_time_ < kEngineSpeedExpiry &&
+         engine_speed_.get() < kEngineStoppedSpeed;
+}
+
+void FuelRateEstimator::set(const float& input) {
+  unsigned long now = millis();
+  // Work in liters and hours to keep the float arithmetic well scaled.
+  float volume = input * kLitersPerCubicMeter;
+  float dt = (now - last_update_) / (1000 * kSecondsPerHour);
+  last_update_ = now;
+
+  if (is_engine_stopped()) {
+    filter_.pin_rate(0);
+  }
+  float consumption = filter_.update(volume, dt);
+  if (is_engine_stopped()) {
+    consumption = 0;
+  }
+  this->emit(consumption / kLitersPerCubicMeter / kSecondsPerHour);
+}
+
+bool FuelRateEstimator::to_json(JsonObject& root) {
+  root["volume_noise"] = volume_noise_;
+  root["rate_noise"] = rate_noise_;
+  root["refuel_threshold"] = refuel_threshold_;
+  return true;
+}
+
+bool FuelRateEstimator::from_json(const JsonObject& config) {
+  if (!config["volume_noise"].is<float>() ||
+      !config["rate_noise"].is<float>() ||
+      !config["refuel_threshold"].is<float>()) {
+    return false;
+  }
+  volume_noise_ = config["volume_noise"];
+  rate_noise_ = config["rate_noise"];
+  refuel_threshold_ = config["refuel_threshold"];
+  filter_.configure(volume_noise_, rate_noise_ * rate_noise_ * 60,
+                    refuel_threshold_);
+  return true;
+}
+
+const String ConfigSchema(const FuelRateEstimator& obj) {
+  return R"###({
+    "type": "object",
+    "properties": {
+      "volume_noise": { "title": "Volume noise", "type": "number", "description": "Standard deviation of the filtered tank volume, in liters" },
+      "rate_noise": { "title": "Rate variability", "type": "number", "description": "How fast the consumption can change, in l/h per minute. Higher values track changes faster but give a noisier estimate." },
+      "refuel_threshold": { "title": "Refuel threshold", "type": "number", "description": "Volume increase, in standard deviations of the estimate, that is treated as refueling" }
+    }
+  })###";
+}
+
+}  // namespace halmet
@@ -0,0 +1,55 @@
+#ifndef HALMET_SRC_HALMET_FUEL_RATE_H_
+#define HALMET_SRC_HALMET_FUEL_RATE_H_
+
+#include "rate_kalman.h"
+#include "sensesp/system/observablevalue.h"
+#include "sensesp/transforms/transform.h"
+
+namespace halmet {
+
+/**
+ * @brief Estimates fuel consumption from the tank volume.
+ *
+ * Input is the (filtered) tank volume in m3, output the consumption rate in
+ * m3/s, the Signal K unit. A ConsumptionRateFilter tracks the volume and
+ * its rate of change at O(1) cost per sample.
+ *
+ * If engine_speed_ is connected to a tacho output (in Hz), the estimate is
+ * held at zero while the engine is stopped, so tank noise is not reported
+ * as consumption. Refueling shows up as a large positive innovation and
+ * restarts the volume estimate without disturbing the rate.
+ */
+class FuelRateEstimator : public sensesp::FloatTransform {
+ public:
+  FuelRateEstimator(String config_path = "");
+
+  virtual void set(const float& input) override;
+
+  virtual bool to_json(JsonObject& root) override;
+  virtual bool from_json(const JsonObject& config) override;
+
+  // Optional engine speed input, in Hz
+  sensesp::ObservableValue<float> engine_speed_;
+
+ protected:
+  bool is_engine_stopped();
+
+  float volume_noise_ = 0.5;      // Standard deviation of the input, l
+  float rate_noise_ = 2;          // Expected change of consumption, l/h/min
+  float refuel_threshold_ = 10;   // Innovation in standard deviations
+
+  ConsumptionRateFilter filter_;
+  unsigned long last_update_ = 0;
+  bool engine_speed_connected_ = false;
+  unsigned long engine_speed_time_ = 0;
+};
+
+const String ConfigSchema(const FuelRateEstimator& obj);
+
+inline bool ConfigRequiresRestart(const FuelRateEstimator& obj) {
+  return false;
+}
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_FUEL_RATE_H_
@@ -0,0 +1,98 @@
+#include "halmet_i2c.h"
+
+#include "halmet_profiler.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+// Interval for logging the bus statistics, in ms.
+const unsigned int kI2CStatsInterval = 60000;
+
+I2CScheduler::I2CScheduler(TwoWire* i2c) : i2c_{i2c} {
+  OnTick("I2C scheduler", [this]() { run_slice(); });
+
+  OnRepeat("I2C stats", kI2CStatsInterval, [this]() {
+    for (int i = 0; i < num_clients_; i++) {
+      float occupancy = get_occupancy(i);
+      ClientStats stats = get_stats(i);
+      debugD("I2C %s: %lu transactions, %.1f%% of bus time, max %lu us",
+             stats.name, stats.transactions, 100 * occupancy, stats.max_us);
+    }
+  });
+}
+
+int I2CScheduler::add_client(const char* name, Priority priority) {
+  if (num_clients_ == kMaxClients) {
+    debugE("Too many I2C clients, %s not added", name);
+    return -1;
+  }
+  int id = num_clients_++;
+  clients_[id].priority = priority;
+  clients_[id].stats.name = name;
+  clients_[id].occupancy_start_us = micros();
+  return id;
+}
+
+void I2CScheduler::submit(int client, std::function<bool()> job) {
+  if (client < 0 || client >= num_clients_) {
+    return;
+  }
+  clients_[client].job = std::move(job);
+}
+
+bool I2CScheduler::is_pending(int client) const {
+  return client >= 0 && client < num_clients_ && clients_[client].job;
+}
+
+I2CScheduler::ClientStats I2CScheduler::get_stats(int client) {
+  ClientStats stats = clients_[client].stats;
+  clients_[client].stats.max_us = 0;
+  return stats;
+}
+
+float I2CScheduler::get_occupancy(int client) {
+  Client& c = clients_[client];
+  unsigned long now = micros();
+  unsigned long elapsed = now - c.occupancy_start_us;
+  float occupancy = elapsed > 0 ? (float)c.occupancy_busy_us / elapsed : 0;
+  c.occupancy_busy_us = 0;
+  c.occupancy_start_us = now;
+  return occupancy;
+}
+
+void I2CScheduler::account(int client, unsigned long elapsed_us) {
+  if (client < 0 || client >= num_clients_) {
+    return;
+  }
+  ClientStats& stats = clients_[client].stats;
+  stats.transactions++;
+  stats.busy_us += elapsed_us;
+  if (elapsed_us > stats.max_us) {
+    stats.max_us = elapsed_us;
+  }
+  clients_[client].occupancy_busy_us += elapsed_us;
+}
+
+void I2CScheduler::run_slice() {
+  int next = -1;
+  for (int i = 0; i < num_clients_; i++) {
+    if (clients_[i].job &&
+        (next == -1 || clients_[i].priority < clients_[next].priority)) {
+      next = i;
+    }
+  }
+  if (next == -1) {
+    return;
+  }
+
+  // The job may submit a follow-up job for the same client, so move it out
+  // before running it.
+  std::function<bool()> job = std::move(clients_[next].job);
+  clients_[next].job = nullptr;
+  bool more = run(next, job);
+  if (more && !clients_[next].job) {
+    clients_[next].job = std::move(job);
+  }
+}
+
+}  // namespace halmet
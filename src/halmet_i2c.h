@@ -0,0 +1,96 @@
+#ifndef HALMET_SRC_HALMET_I2C_H_
+#define HALMET_SRC_HALMET_I2C_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <functional>
+#include <type_traits>
+
+namespace halmet {
+
+/**
+ * @brief Arbitrates the shared I2C bus between its clients.
+ *
+ * Clients register with a priority. Short transactions, such as ADC
+ * conversion starts and result reads, run immediately through run(). Long
+ * transfers, such as display updates, are submitted as jobs that transfer
+ * one slice per call. The scheduler runs one slice per event loop tick,
+ * highest priority first, so a pending ADC read waits for at most one slice
+ * instead of a whole framebuffer.
+ *
+ * All bus access happens on the event loop. The scheduler measures the bus
+ * time used by each client and logs it periodically.
+ */
+class I2CScheduler {
+ public:
+  enum class Priority { kHigh, kNormal, kLow };
+
+  struct ClientStats {
+    const char* name = nullptr;
+    unsigned long transactions = 0;  // run() calls and job slices
+    unsigned long busy_us = 0;       // Total bus time
+    unsigned long max_us = 0;        // Longest transaction or slice
+  };
+
+  explicit I2CScheduler(TwoWire* i2c);
+
+  TwoWire* get_bus() const { return i2c_; }
+
+  /// Register a client. Returns the client id.
+  int add_client(const char* name, Priority priority);
+
+  /// Run a short transaction immediately and account its bus time.
+  template <typename F>
+  auto run(int client, F&& fn) -> decltype(fn()) {
+    unsigned long start = micros();
+    if constexpr (std::is_void<decltype(fn())>::value) {
+      fn();
+      account(client, micros() - start);
+    } else {
+      auto result = fn();
+      account(client, micros() - start);
+      return result;
+    }
+  }
+
+  /**
+   * @brief Queue a long transfer.
+   *
+   * The job transfers one slice per call and returns true while slices
+   * remain. A client has at most one job queued; submitting again while it
+   * is pending replaces it.
+   */
+  void submit(int client, std::function<bool()> job);
+
+  bool is_pending(int client) const;
+
+  /// Snapshot of a client's statistics. Max values are reset after reading.
+  ClientStats get_stats(int client);
+
+  /// Fraction of the time the bus was busy for a client since the last
+  /// call for that client
+  float get_occupancy(int client);
+
+ protected:
+  static const int kMaxClients = 4;
+
+  struct Client {
+    Priority priority;
+    ClientStats stats;
+    std::function<bool()> job;
+    unsigned long occupancy_busy_us = 0;
+    unsigned long occupancy_start_us = 0;
+  };
+
+  void account(int client, unsigned long elapsed_us);
+  void run_slice();
+
+  TwoWire* i2c_;
+  Client clients_[kMaxClients];
+  int num_clients_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_I2C_H_
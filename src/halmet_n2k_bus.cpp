@@ -0,0 +1,134 @@
+#include "halmet_n2k_bus.h"
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <string.h>
+#else
+#include <mutex>
+#endif
+
+namespace halmet {
+
+#ifdef ARDUINO
+
+// TWAI error warning limit, the driver's default
+const uint32_t kCANErrorWarningLimit = 96;
+
+static SemaphoreHandle_t GetN2kBusMutex() {
+  // Constructed on first use from setup(), before the RX task starts.
+  static SemaphoreHandle_t mutex = xSemaphoreCreateRecursiveMutex();
+  return mutex;
+}
+
+N2kBusLock::N2kBusLock() {
+  xSemaphoreTakeRecursive(GetN2kBusMutex(), portMAX_DELAY);
+}
+
+N2kBusLock::~N2kBusLock() { xSemaphoreGiveRecursive(GetN2kBusMutex()); }
+
+#else
+
+// No FreeRTOS on the host; a standard recursive mutex does the same job.
+static std::recursive_mutex& GetN2kBusMutex() {
+  static std::recursive_mutex mutex;
+  return mutex;
+}
+
+N2kBusLock::N2kBusLock() { GetN2kBusMutex().lock(); }
+
+N2kBusLock::~N2kBusLock() { GetN2kBusMutex().unlock(); }
+
+#endif  // ARDUINO
+
+bool SendN2kMsg(tNMEA2000* nmea2000, const tN2kMsg& msg, int device_index) {
+  N2kBusLock lock;
+  return nmea2000->SendMsg(msg, device_index);
+}
+
+#ifdef ARDUINO
+
+bool tNMEA2000_halmet::WaitForFrame(TickType_t timeout) {
+  if (has_pending_frame_) {
+    return true;
+  }
+  esp_err_t result = twai_receive(&pending_frame_, timeout);
+  if (result == ESP_ERR_INVALID_STATE) {
+    // Driver not installed or not running yet; twai_receive() returns
+    // right away.
+    vTaskDelay(timeout);
+    return false;
+  }
+  has_pending_frame_ = result == ESP_OK;
+  return has_pending_frame_;
+}
+
+CANErrorState tNMEA2000_halmet::ReadErrorState() const {
+  CANErrorState state;
+  twai_status_info_t status;
+  if (twai_get_status_info(&status) != ESP_OK) {
+    // Driver not installed yet
+    state.stopped = true;
+    return state;
+  }
+  state.tx_error_counter = status.tx_error_counter;
+  state.rx_error_counter = status.rx_error_counter;
+  state.error_warning = status.tx_error_counter >= kCANErrorWarningLimit ||
+                        status.rx_error_counter >= kCANErrorWarningLimit;
+  state.bus_off = status.state == TWAI_STATE_BUS_OFF;
+  state.recovering = status.state == TWAI_STATE_RECOVERING;
+  state.stopped = status.state == TWAI_STATE_STOPPED;
+  state.arb_lost_count = status.arb_lost_count;
+  state.bus_error_count = status.bus_error_count;
+  state.tx_failed_count = status.tx_failed_count;
+  state.rx_missed_count = status.rx_missed_count;
+  return state;
+}
+
+void tNMEA2000_halmet::StartBusOffRecovery() { twai_initiate_recovery(); }
+
+void tNMEA2000_halmet::FinishBusOffRecovery() { twai_start(); }
+
+void tNMEA2000_halmet::FlushTxQueue() { twai_clear_transmit_queue(); }
+
+bool tNMEA2000_halmet::CANSendFrame(unsigned long id, unsigned char len,
+                                    const unsigned char* buf, bool wait_sent) {
+  if (tx_suspended_) {
+    // Report success so the library doesn't buffer the frame for a retry.
+    // By the time the bus is back the value would be stale.
+    dropped_tx_frames_++;
+    return true;
+  }
+  bool sent = tNMEA2000_esp32::CANSendFrame(id, len, buf, wait_sent);
+  if (sent) {
+    tx_frames_++;
+  }
+  return sent;
+}
+
+bool tNMEA2000_halmet::CANGetFrame(unsigned long& id, unsigned char& len,
+                                   unsigned char* buf) {
+  twai_message_t frame;
+  while (true) {
+    if (has_pending_frame_) {
+      frame = pending_frame_;
+      has_pending_frame_ = false;
+    } else if (twai_receive(&frame, 0) != ESP_OK) {
+      return false;
+    }
+    // NMEA 2000 only uses extended data frames
+    if (frame.extd && !frame.rtr) {
+      break;
+    }
+  }
+
+  id = frame.identifier;
+  len = frame.data_length_code > 8 ? 8 : frame.data_length_code;
+  memcpy(buf, frame.data, len);
+  rx_frames_++;
+  return true;
+}
+
+#endif  // ARDUINO
+
+}  // namespace halmet
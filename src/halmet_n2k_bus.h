@@ -0,0 +1,122 @@
+#ifndef HALMET_SRC_HALMET_N2K_BUS_H_
+#define HALMET_SRC_HALMET_N2K_BUS_H_
+
+#include <NMEA2000.h>
+
+#include <atomic>
+
+#ifdef ARDUINO
+#include <NMEA2000_esp32.h>
+#include <driver/twai.h>
+#endif
+
+namespace halmet {
+
+/**
+ * @brief Scoped lock serializing access to the tNMEA2000 object.
+ *
+ * tNMEA2000 is not thread safe. Received messages are parsed in the
+ * N2kRxTask while the senders transmit from the event loop, so any call
+ * into the library outside the RX task must hold this lock. The lock is
+ * recursive: message handlers running in the RX task may send.
+ */
+class N2kBusLock {
+ public:
+  N2kBusLock();
+  ~N2kBusLock();
+
+  N2kBusLock(const N2kBusLock&) = delete;
+  N2kBusLock& operator=(const N2kBusLock&) = delete;
+};
+
+/// Send an N2K message while holding the bus lock.
+bool SendN2kMsg(tNMEA2000* nmea2000, const tN2kMsg& msg,
+                int device_index = -1);
+
+#ifdef ARDUINO
+
+/// Error state of the CAN controller, as reported by the TWAI driver.
+struct CANErrorState {
+  uint16_t tx_error_counter = 0;
+  uint16_t rx_error_counter = 0;
+  bool error_warning = false;  // An error counter has reached 96
+  bool bus_off = false;
+  bool recovering = false;     // Bus-off recovery sequence in progress
+  bool stopped = false;        // Controller is not participating on the bus
+  // Event counts kept by the driver since it was installed
+  uint32_t arb_lost_count = 0;   // Arbitration lost while transmitting
+  uint32_t bus_error_count = 0;  // Bit, stuff, form, CRC or ACK errors
+  uint32_t tx_failed_count = 0;  // Frames that failed to transmit
+  uint32_t rx_missed_count = 0;  // Frames lost to a full RX queue
+};
+
+/**
+ * @brief ESP32 NMEA 2000 driver that lets a task sleep until a CAN frame
+ * arrives.
+ *
+ * Reception goes through the ESP-IDF TWAI driver directly: WaitForFrame()
+ * blocks in twai_receive() and keeps the frame it got for the next
+ * CANGetFrame() call, so the RX task wakes once per received frame instead
+ * of at a fixed polling interval.
+ *
+ * The driver also exposes the controller error state and the bus-off
+ * recovery sequence for N2kBusHealthMonitor. While transmission is
+ * suspended, frames are discarded instead of piling up in the driver and
+ * library send buffers.
+ */
+class tNMEA2000_halmet : public tNMEA2000_esp32 {
+ public:
+  tNMEA2000_halmet(gpio_num_t tx_pin, gpio_num_t rx_pin)
+      : tNMEA2000_esp32(tx_pin, rx_pin) {}
+
+  /// Block until a frame is received or the timeout expires. Returns true
+  /// if a frame is pending. The frame is returned by the next
+  /// CANGetFrame(). Only call this from the task that parses the messages.
+  bool WaitForFrame(TickType_t timeout);
+
+  CANErrorState ReadErrorState() const;
+
+  /// Start the bus-off recovery sequence. The controller waits for 128
+  /// sequences of 11 recessive bits, about 6 ms at 250 kbit/s, and then
+  /// stops; FinishBusOffRecovery() puts it back on the bus.
+  void StartBusOffRecovery();
+
+  /// Restart the controller once recovery has left it stopped.
+  void FinishBusOffRecovery();
+
+  /// Discard the frames waiting in the driver's transmit queue.
+  void FlushTxQueue();
+
+  void SetTxSuspended(bool suspended) { tx_suspended_ = suspended; }
+  bool IsTxSuspended() const { return tx_suspended_; }
+
+  /// Number of frames discarded while transmission was suspended
+  unsigned long GetDroppedTxFrames() const { return dropped_tx_frames_; }
+
+  /// Total number of frames received and handed to the library
+  unsigned long GetRxFrames() const { return rx_frames_; }
+  /// Total number of frames queued for transmission
+  unsigned long GetTxFrames() const { return tx_frames_; }
+
+ protected:
+  bool CANSendFrame(unsigned long id, unsigned char len,
+                    const unsigned char* buf, bool wait_sent = true) override;
+  bool CANGetFrame(unsigned long& id, unsigned char& len,
+                   unsigned char* buf) override;
+
+  // Frame received by WaitForFrame(), not yet handed to the library. Only
+  // accessed by the RX task.
+  twai_message_t pending_frame_;
+  bool has_pending_frame_ = false;
+
+  std::atomic<bool> tx_suspended_{false};
+  std::atomic<unsigned long> dropped_tx_frames_{0};
+  std::atomic<unsigned long> rx_frames_{0};
+  std::atomic<unsigned long> tx_frames_{0};
+};
+
+#endif  // ARDUINO
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_N2K_BUS_H_
@@ -0,0 +1,151 @@
+#include "halmet_n2k_health.h"
+
+#include "halmet_profiler.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+// Error counter value above which the controller is error passive
+const uint8_t kCANErrorPassiveLimit = 128;
+
+// A bus-off within this time of the previous recovery doubles the backoff,
+// in ms.
+const unsigned long kN2kBusOffRepeatWindow = 1000;
+
+// Backoff before the first repeated recovery attempt and the maximum, in ms.
+const unsigned long kN2kMinBackoff = 10;
+const unsigned long kN2kMaxBackoff = 5000;
+
+// Interval for emitting the error counters, in ms.
+const unsigned int kN2kHealthOutputInterval = 1000;
+
+// Increase of a driver event count since the previous reading. The driver
+// restarts its counts from zero when it is reinstalled.
+static uint32_t CountSince(uint32_t count, uint32_t previous) {
+  return count >= previous ? count - previous : count;
+}
+
+const char* N2kBusStateName(N2kBusState state) {
+  switch (state) {
+    case N2kBusState::kErrorActive:
+      return "OK";
+    case N2kBusState::kErrorWarning:
+      return "Warning";
+    case N2kBusState::kErrorPassive:
+      return "Error passive";
+    case N2kBusState::kBusOff:
+      return "Bus off";
+    case N2kBusState::kRecovering:
+      return "Recovering";
+  }
+  return "Unknown";
+}
+
+N2kBusHealthMonitor::N2kBusHealthMonitor(tNMEA2000_halmet* nmea2000,
+                                         unsigned int poll_interval)
+    : state_name_{N2kBusStateName(N2kBusState::kErrorActive)},
+      tx_error_counter_{0},
+      rx_error_counter_{0},
+      bus_off_count_{0},
+      arb_lost_count_{0},
+      bus_error_count_{0},
+      tx_failed_count_{0},
+      rx_missed_count_{0},
+      nmea2000_{nmea2000} {
+  OnRepeat("N2K health poll", poll_interval, [this]() { poll(); });
+
+  OnRepeat("N2K health output", kN2kHealthOutputInterval, [this]() {
+    tx_error_counter_.set(stats_.error_state.tx_error_counter);
+    rx_error_counter_.set(stats_.error_state.rx_error_counter);
+    bus_off_count_.set(stats_.bus_off_count);
+    arb_lost_count_.set(stats_.arb_lost_count);
+    bus_error_count_.set(stats_.bus_error_count);
+    tx_failed_count_.set(stats_.tx_failed_count);
+    rx_missed_count_.set(stats_.rx_missed_count);
+  });
+}
+
+void N2kBusHealthMonitor::poll() {
+  CANErrorState error_state = nmea2000_->ReadErrorState();
+  count_events(error_state);
+  stats_.error_state = error_state;
+  stats_.dropped_tx_frames = nmea2000_->GetDroppedTxFrames();
+  unsigned long now = millis();
+
+  switch (state_) {
+    case N2kBusState::kBusOff:
+      if (now - bus_off_time_ >= backoff_) {
+        nmea2000_->StartBusOffRecovery();
+        set_state(N2kBusState::kRecovering);
+      }
+      return;
+    case N2kBusState::kRecovering:
+      if (error_state.bus_off || error_state.recovering) {
+        return;
+      }
+      if (error_state.stopped) {
+        // Recovery complete; the controller rejoins the bus once started.
+        nmea2000_->FinishBusOffRecovery();
+        return;
+      }
+      stats_.recoveries++;
+      stats_.last_recovery_ms = now - bus_off_time_;
+      recovered_time_ = now;
+      nmea2000_->SetTxSuspended(false);
+      debugI("NMEA 2000 bus recovered after %lu ms", stats_.last_recovery_ms);
+      break;
+    default:
+      if (error_state.bus_off) {
+        stats_.bus_off_count++;
+        bus_off_time_ = now;
+        // Back off if the bus keeps dropping off right after recovering.
+        if (stats_.recoveries > 0 &&
+            now - recovered_time_ < kN2kBusOffRepeatWindow) {
+          backoff_ = backoff_ == 0 ? kN2kMinBackoff : 2 * backoff_;
+          if (backoff_ > kN2kMaxBackoff) {
+            backoff_ = kN2kMaxBackoff;
+          }
+        } else {
+          backoff_ = 0;
+        }
+        nmea2000_->SetTxSuspended(true);
+        nmea2000_->FlushTxQueue();
+        debugW("NMEA 2000 bus off (TEC %d), retrying in %lu ms",
+               error_state.tx_error_counter, backoff_);
+        set_state(N2kBusState::kBusOff);
+        return;
+      }
+      break;
+  }
+
+  if (error_state.tx_error_counter >= kCANErrorPassiveLimit ||
+      error_state.rx_error_counter >= kCANErrorPassiveLimit) {
+    set_state(N2kBusState::kErrorPassive);
+  } else if (error_state.error_warning) {
+    set_state(N2kBusState::kErrorWarning);
+  } else {
+    set_state(N2kBusState::kErrorActive);
+  }
+}
+
+void N2kBusHealthMonitor::count_events(const CANErrorState& error_state) {
+  const CANErrorState& previous = stats_.error_state;
+  stats_.arb_lost_count +=
+      CountSince(error_state.arb_lost_count, previous.arb_lost_count);
+  stats_.bus_error_count +=
+      CountSince(error_state.bus_error_count, previous.bus_error_count);
+  stats_.tx_failed_count +=
+      CountSince(error_state.tx_failed_count, previous.tx_failed_count);
+  stats_.rx_missed_count +=
+      CountSince(error_state.rx_missed_count, previous.rx_missed_count);
+}
+
+void N2kBusHealthMonitor::set_state(N2kBusState state) {
+  if (state == state_) {
+    return;
+  }
+  state_ = state;
+  state_name_.set(N2kBusStateName(state));
+}
+
+}  // namespace halmet
@@ -0,0 +1,80 @@
+#ifndef HALMET_SRC_HALMET_N2K_HEALTH_H_
+#define HALMET_SRC_HALMET_N2K_HEALTH_H_
+
+#include "halmet_n2k_bus.h"
+#include "sensesp/system/observablevalue.h"
+
+namespace halmet {
+
+enum class N2kBusState {
+  kErrorActive,   // Normal operation
+  kErrorWarning,  // An error counter has reached the warning limit
+  kErrorPassive,  // An error counter has reached 128
+  kBusOff,        // Controller has left the bus, waiting for backoff
+  kRecovering,    // Bus-off recovery sequence in progress
+};
+
+const char* N2kBusStateName(N2kBusState state);
+
+/**
+ * @brief Monitors the CAN controller error state and recovers from bus-off.
+ *
+ * The controller error counters and bus state are polled from the event
+ * loop. On bus-off, transmission is suspended and the stale frames queued
+ * for sending are discarded. Recovery starts immediately; if the bus drops
+ * off again shortly after recovering (e.g. a persistent short), the delay
+ * before the next attempt doubles up to a maximum.
+ *
+ * The driver's arbitration lost, bus error, failed transmission and missed
+ * reception counts are accumulated into the stats, so they keep counting
+ * across a driver restart.
+ *
+ * The state name is emitted on every change and the error counters and
+ * event counts once per second.
+ */
+class N2kBusHealthMonitor {
+ public:
+  struct Stats {
+    CANErrorState error_state;
+    unsigned long bus_off_count = 0;    // Bus-off events since boot
+    unsigned long recoveries = 0;       // Successful recoveries since boot
+    unsigned long last_recovery_ms = 0; // Duration of the last recovery
+    unsigned long dropped_tx_frames = 0;
+    unsigned long arb_lost_count = 0;   // Arbitration lost since boot
+    unsigned long bus_error_count = 0;  // Bus errors since boot
+    unsigned long tx_failed_count = 0;  // Failed transmissions since boot
+    unsigned long rx_missed_count = 0;  // Frames missed since boot
+  };
+
+  N2kBusHealthMonitor(tNMEA2000_halmet* nmea2000,
+                      unsigned int poll_interval = 10);
+
+  N2kBusState get_state() const { return state_; }
+  Stats get_stats() const { return stats_; }
+
+  sensesp::ObservableValue<String> state_name_;
+  sensesp::ObservableValue<int> tx_error_counter_;
+  sensesp::ObservableValue<int> rx_error_counter_;
+  sensesp::ObservableValue<int> bus_off_count_;
+  sensesp::ObservableValue<int> arb_lost_count_;
+  sensesp::ObservableValue<int> bus_error_count_;
+  sensesp::ObservableValue<int> tx_failed_count_;
+  sensesp::ObservableValue<int> rx_missed_count_;
+
+ protected:
+  void poll();
+  void set_state(N2kBusState state);
+  void count_events(const CANErrorState& error_state);
+
+  tNMEA2000_halmet* nmea2000_;
+  N2kBusState state_ = N2kBusState::kErrorActive;
+  Stats stats_;
+
+  unsigned long bus_off_time_ = 0;
+  unsigned long recovered_time_ = 0;
+  unsigned long backoff_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_N2K_HEALTH_H_
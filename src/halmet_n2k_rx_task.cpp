@@ -0,0 +1,93 @@
+#include "halmet_n2k_rx_task.h"
+
+#include "halmet_profiler.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+// ParseMessages() also drives address claiming, heartbeats and pending
+// fast-packet transmissions, so call it at least this often even when the
+// bus is silent.
+const TickType_t kN2kHousekeepingInterval = pdMS_TO_TICKS(20);
+
+// Interval for logging the task statistics, in ms.
+const unsigned int kN2kRxStatsInterval = 60000;
+
+// ParseMessages() keeps a tN2kMsg (~250 bytes) on the stack for the message
+// being assembled and the handlers copy it once more into the callable they
+// post. The rest is headroom for the library's fast-packet and ISO request
+// handling. The statistics log reports the actual minimum free stack.
+const uint32_t kN2kRxTaskStackSize = 6144;
+
+N2kRxTask::N2kRxTask(tNMEA2000_halmet* nmea2000, BaseType_t core,
+                     UBaseType_t priority)
+    : nmea2000_{nmea2000}, core_{core}, priority_{priority} {
+  // Run the callables posted by the message handlers on the event loop.
+  OnTick("N2K RX handlers", [this]() {
+    std::function<void()> fn;
+    while (to_event_loop_.pop(fn)) {
+      fn();
+    }
+  });
+
+  OnRepeat("N2K RX stats", kN2kRxStatsInterval, [this]() {
+    Stats stats = get_stats();
+    debugD(
+        "N2K RX task: %lu wakeups (%lu on frames), busy %lu us, max parse "
+        "%lu us, dropped %lu, min free stack %lu",
+        stats.wakeups, stats.frame_wakeups, stats.busy_us, stats.max_parse_us,
+        stats.posted_dropped, stats.min_free_stack);
+  });
+}
+
+void N2kRxTask::start() {
+  if (task_ != nullptr) {
+    return;
+  }
+  xTaskCreatePinnedToCore(task_entry, "n2k_rx", kN2kRxTaskStackSize, this,
+                          priority_, &task_, core_);
+}
+
+N2kRxTask::Stats N2kRxTask::get_stats() {
+  portENTER_CRITICAL(&stats_mux_);
+  Stats stats = stats_;
+  stats_.max_parse_us = 0;
+  portEXIT_CRITICAL(&stats_mux_);
+  stats.posted_dropped = to_event_loop_.get_dropped();
+  if (task_ != nullptr) {
+    stats.min_free_stack = uxTaskGetStackHighWaterMark(task_);
+  }
+  return stats;
+}
+
+void N2kRxTask::task_entry(void* arg) {
+  static_cast<N2kRxTask*>(arg)->run();
+}
+
+void N2kRxTask::run() {
+  while (true) {
+    // Blocks in the CAN driver without holding the bus lock, so the senders
+    // on the event loop can transmit meanwhile.
+    bool frame_pending = nmea2000_->WaitForFrame(kN2kHousekeepingInterval);
+
+    unsigned long start = micros();
+    {
+      N2kBusLock lock;
+      nmea2000_->ParseMessages();
+    }
+    unsigned long elapsed = micros() - start;
+
+    portENTER_CRITICAL(&stats_mux_);
+    stats_.wakeups++;
+    if (frame_pending) {
+      stats_.frame_wakeups++;
+    }
+    stats_.busy_us += elapsed;
+    if (elapsed > stats_.max_parse_us) {
+      stats_.max_parse_us = elapsed;
+    }
+    portEXIT_CRITICAL(&stats_mux_);
+  }
+}
+
+}  // namespace halmet
@@ -0,0 +1,69 @@
+#ifndef HALMET_SRC_HALMET_N2K_RX_TASK_H_
+#define HALMET_SRC_HALMET_N2K_RX_TASK_H_
+
+#include <functional>
+
+#include "halmet_n2k_bus.h"
+#include "spsc_queue.h"
+
+namespace halmet {
+
+/**
+ * @brief FreeRTOS task that receives and parses NMEA 2000 messages.
+ *
+ * Replaces polling ParseMessages() from the event loop. The task sleeps in
+ * the CAN driver's receive call until a frame arrives, so an idle bus costs
+ * only an occasional housekeeping wakeup and a slow event loop callback no
+ * longer delays CAN reception.
+ *
+ * The wait happens without the bus lock. The lock is only held while
+ * ParseMessages() drains the received frames, which includes running the
+ * message handlers attached to the tNMEA2000 object. Handlers must
+ * therefore be quick: anything slow or blocking (network I/O, JSON,
+ * emitting to SensESP producers) is handed to the event loop with post().
+ */
+class N2kRxTask {
+ public:
+  struct Stats {
+    unsigned long wakeups = 0;           // Total task wakeups
+    unsigned long frame_wakeups = 0;     // Wakeups caused by a received frame
+    unsigned long max_parse_us = 0;      // Longest ParseMessages() call
+    unsigned long busy_us = 0;           // Total time spent parsing
+    unsigned long posted_dropped = 0;    // post() calls rejected, queue full
+    unsigned long min_free_stack = 0;    // Stack high water mark, bytes
+  };
+
+  N2kRxTask(tNMEA2000_halmet* nmea2000, BaseType_t core = 0,
+            UBaseType_t priority = 5);
+
+  /// Start receiving. Attach the message handlers before calling this:
+  /// the handler list is not protected by the bus lock.
+  void start();
+
+  /// Queue a callable to run on the event loop. Only call this from the
+  /// RX task, i.e. from within a message handler. Returns false if the
+  /// queue is full.
+  bool post(std::function<void()> fn) { return to_event_loop_.push(fn); }
+
+  /// Snapshot of the task statistics. Max values are reset after reading.
+  Stats get_stats();
+
+ protected:
+  static void task_entry(void* arg);
+  void run();
+
+  tNMEA2000_halmet* nmea2000_;
+  BaseType_t core_;
+  UBaseType_t priority_;
+  TaskHandle_t task_ = nullptr;
+  // Deep enough for a burst of forwarded messages between two event loop
+  // passes
+  SpscQueue<std::function<void()>, 32> to_event_loop_;
+
+  Stats stats_;
+  portMUX_TYPE stats_mux_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_N2K_RX_TASK_H_
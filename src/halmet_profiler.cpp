@@ -0,0 +1,139 @@
+#include "halmet_profiler.h"
+
+#ifdef HALMET_ENABLE_PROFILER
+
+#include <ArduinoJson.h>
+#include <esp_http_server.h>
+
+#include <cstring>
+
+namespace halmet {
+
+namespace {
+
+struct ProfilerSlot {
+  const char* name;
+  uint32_t calls;
+  uint64_t total_us;
+  uint32_t max_us;
+  uint32_t histogram[Profiler::kBuckets];
+};
+
+portMUX_TYPE profiler_mux = portMUX_INITIALIZER_UNLOCKED;
+ProfilerSlot profiler_slots[Profiler::kMaxSlots];
+int profiler_slot_count = 0;
+unsigned long profiler_period_start_ms = 0;
+
+esp_err_t HandleProfile(httpd_req_t* req) {
+  bool reset = false;
+  char query[32];
+  char value[8];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+      httpd_query_key_value(query, "reset", value, sizeof(value)) == ESP_OK) {
+    reset = strcmp(value, "0") != 0;
+  }
+  String json = Profiler::to_json(reset);
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_send(req, json.c_str(), json.length());
+}
+
+}  // namespace
+
+int Profiler::add_slot(const char* name) {
+  // Slots are added from setup() and the event loop while the HTTP server
+  // task may be reading them
+  int slot = -1;
+  portENTER_CRITICAL(&profiler_mux);
+  if (profiler_slot_count < kMaxSlots) {
+    slot = profiler_slot_count++;
+    memset(&profiler_slots[slot], 0, sizeof(ProfilerSlot));
+    profiler_slots[slot].name = name;
+  }
+  portEXIT_CRITICAL(&profiler_mux);
+  return slot;
+}
+
+void Profiler::record(int slot, uint32_t duration_us) {
+  if (slot < 0) {
+    return;
+  }
+  int bucket = duration_us > 1 ? 31 - __builtin_clz(duration_us) : 0;
+  if (bucket >= kBuckets) {
+    bucket = kBuckets - 1;
+  }
+  portENTER_CRITICAL(&profiler_mux);
+  ProfilerSlot& s = profiler_slots[slot];
+  s.calls++;
+  s.total_us += duration_us;
+  if (duration_us > s.max_us) {
+    s.max_us = duration_us;
+  }
+  s.histogram[bucket]++;
+  portEXIT_CRITICAL(&profiler_mux);
+}
+
+String Profiler::to_json(bool reset) {
+  JsonDocument doc;
+  unsigned long now = millis();
+  doc["period_ms"] = now - profiler_period_start_ms;
+  JsonArray callbacks = doc["callbacks"].to<JsonArray>();
+
+  portENTER_CRITICAL(&profiler_mux);
+  int slot_count = profiler_slot_count;
+  portEXIT_CRITICAL(&profiler_mux);
+
+  for (int i = 0; i < slot_count; i++) {
+    // Copy one slot at a time to keep the critical section short
+    ProfilerSlot s;
+    portENTER_CRITICAL(&profiler_mux);
+    s = profiler_slots[i];
+    if (reset) {
+      const char* name = profiler_slots[i].name;
+      memset(&profiler_slots[i], 0, sizeof(ProfilerSlot));
+      profiler_slots[i].name = name;
+    }
+    portEXIT_CRITICAL(&profiler_mux);
+
+    JsonObject callback = callbacks.add<JsonObject>();
+    callback["name"] = s.name;
+    callback["calls"] = s.calls;
+    callback["total_us"] = s.total_us;
+    callback["max_us"] = s.max_us;
+    callback["mean_us"] = s.calls > 0 ? (float)s.total_us / s.calls : 0;
+    JsonArray histogram = callback["histogram"].to<JsonArray>();
+    for (int bucket = 0; bucket < kBuckets; bucket++) {
+      histogram.add(s.histogram[bucket]);
+    }
+  }
+  if (reset) {
+    profiler_period_start_ms = now;
+  }
+
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+void Profiler::start_server(uint16_t port) {
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.server_port = port;
+  // The SensESP web server uses the default control port
+  config.ctrl_port = port;
+  config.stack_size = 6144;
+
+  httpd_handle_t server = nullptr;
+  if (httpd_start(&server, &config) != ESP_OK) {
+    debugE("Failed to start the profiler server on port %u", port);
+    return;
+  }
+  httpd_uri_t uri = {};
+  uri.uri = "/profile";
+  uri.method = HTTP_GET;
+  uri.handler = HandleProfile;
+  httpd_register_uri_handler(server, &uri);
+  debugI("Profiler results at http://<device>:%u/profile", port);
+}
+
+}  // namespace halmet
+
+#endif  // HALMET_ENABLE_PROFILER
@@ -0,0 +1,91 @@
+#ifndef HALMET_SRC_HALMET_PROFILER_H_
+#define HALMET_SRC_HALMET_PROFILER_H_
+
+#include <Arduino.h>
+
+#include <utility>
+
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+#ifdef HALMET_ENABLE_PROFILER
+
+/**
+ * @brief Event loop callback profiler.
+ *
+ * Enabled with the HALMET_ENABLE_PROFILER build flag. Every callback
+ * registered with OnRepeat(), OnDelay() or OnTick() gets a named slot with
+ * its call count, total and maximum run time and a histogram of run times
+ * in power-of-two buckets. Callbacks registered at the same call site share
+ * a slot.
+ *
+ * The results are served as JSON at http://<device>:8081/profile. Add
+ * "?reset=1" to start a new measurement period after reading.
+ */
+class Profiler {
+ public:
+  static const int kMaxSlots = 48;
+  // Bucket i counts run times from 2^i to 2^(i+1) us; the last bucket
+  // also counts everything longer.
+  static const int kBuckets = 20;
+  static const uint16_t kPort = 8081;
+
+  /// Returns the slot for the name, or -1 if all slots are taken.
+  static int add_slot(const char* name);
+  static void record(int slot, uint32_t duration_us);
+  static String to_json(bool reset);
+  static void start_server(uint16_t port = kPort);
+};
+
+template <typename F>
+auto Profiled(int slot, F&& callback) {
+  return [slot, callback = std::forward<F>(callback)]() mutable {
+    uint32_t start = micros();
+    callback();
+    Profiler::record(slot, micros() - start);
+  };
+}
+
+#endif  // HALMET_ENABLE_PROFILER
+
+// Event loop registration helpers. The name only matters to the profiler;
+// without it, these compile to plain event_loop() calls. Every lambda has
+// its own type, so each call site gets its own template instance and slot.
+
+template <typename F>
+auto OnRepeat(const char* name, uint32_t interval, F&& callback) {
+#ifdef HALMET_ENABLE_PROFILER
+  static int slot = Profiler::add_slot(name);
+  return sensesp::event_loop()->onRepeat(
+      interval, Profiled(slot, std::forward<F>(callback)));
+#else
+  return sensesp::event_loop()->onRepeat(interval, std::forward<F>(callback));
+#endif
+}
+
+template <typename F>
+auto OnDelay(const char* name, uint32_t delay, F&& callback) {
+#ifdef HALMET_ENABLE_PROFILER
+  static int slot = Profiler::add_slot(name);
+  return sensesp::event_loop()->onDelay(
+      delay, Profiled(slot, std::forward<F>(callback)));
+#else
+  return sensesp::event_loop()->onDelay(delay, std::forward<F>(callback));
+#endif
+}
+
+template <typename F>
+auto OnTick(const char* name, F&& callback) {
+#ifdef HALMET_ENABLE_PROFILER
+  static int slot = Profiler::add_slot(name);
+  return sensesp::event_loop()->onTick(
+      Profiled(slot, std::forward<F>(callback)));
+#else
+  return sensesp::event_loop()->onTick(std::forward<F>(callback));
+#endif
+}
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_PROFILER_H_
@@ -0,0 +1,126 @@
+#include "halmet_pulse_counter.h"
+
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+// The PCNT counter resets to zero when it reaches this value.
+const int kPcntLimit = 32767;
+
+// Glitch filter length, in ns. The filter counts APB clock cycles (80 MHz)
+// and is at most 1023 cycles, i.e. about 12.8 us.
+const uint32_t kPcntFilterNs = 12700;
+
+InterruptPulseCounter::InterruptPulseCounter(int pin) {
+  pinMode(pin, INPUT);
+  attachInterruptArg(pin, edge_isr, this, RISING);
+}
+
+void IRAM_ATTR InterruptPulseCounter::edge_isr(void* arg) {
+  auto self = static_cast<InterruptPulseCounter*>(arg);
+  uint32_t now = micros();
+  portENTER_CRITICAL_ISR(&self->edges_mux_);
+  if (self->stored_edges_ > 0 &&
+      now - self->timestamps_[(self->edge_count_ - 1) & (kRingSize - 1)] <
+          self->blanking_us_) {
+    portEXIT_CRITICAL_ISR(&self->edges_mux_);
+    return;
+  }
+  self->timestamps_[self->edge_count_ & (kRingSize - 1)] = now;
+  self->edge_count_++;
+  if (self->stored_edges_ < kRingSize) {
+    self->stored_edges_++;
+  }
+  portEXIT_CRITICAL_ISR(&self->edges_mux_);
+}
+
+PulseSnapshot InterruptPulseCounter::read(int max_periods) {
+  PulseSnapshot snapshot;
+  portENTER_CRITICAL(&edges_mux_);
+  snapshot.count = edge_count_;
+  int stored_edges = stored_edges_;
+  if (stored_edges > 0) {
+    snapshot.newest_us = timestamps_[(snapshot.count - 1) & (kRingSize - 1)];
+  }
+  int periods = std::min(stored_edges - 1, max_periods);
+  if (periods > 0) {
+    snapshot.periods = periods;
+    snapshot.reference_us =
+        timestamps_[(snapshot.count - 1 - periods) & (kRingSize - 1)];
+  }
+  portEXIT_CRITICAL(&edges_mux_);
+  return snapshot;
+}
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+PcntPulseCounter::PcntPulseCounter(int pin) {
+  pcnt_unit_config_t unit_config = {};
+  // The driver requires a negative low limit, even though this counter only
+  // counts up.
+  unit_config.low_limit = -1;
+  unit_config.high_limit = kPcntLimit;
+  pcnt_unit_handle_t unit = nullptr;
+  if (pcnt_new_unit(&unit_config, &unit) != ESP_OK) {
+    debugE("No PCNT unit left for pin %d", pin);
+    return;
+  }
+
+  pcnt_glitch_filter_config_t filter_config = {};
+  filter_config.max_glitch_ns = kPcntFilterNs;
+  pcnt_chan_config_t channel_config = {};
+  channel_config.edge_gpio_num = pin;
+  channel_config.level_gpio_num = -1;
+  pcnt_channel_handle_t channel = nullptr;
+  if (pcnt_unit_set_glitch_filter(unit, &filter_config) != ESP_OK ||
+      pcnt_new_channel(unit, &channel_config, &channel) != ESP_OK ||
+      pcnt_channel_set_edge_action(channel,
+                                   PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+                                   PCNT_CHANNEL_EDGE_ACTION_HOLD) != ESP_OK ||
+      pcnt_unit_enable(unit) != ESP_OK ||
+      pcnt_unit_clear_count(unit) != ESP_OK ||
+      pcnt_unit_start(unit) != ESP_OK) {
+    debugE("Failed to configure a PCNT unit for pin %d", pin);
+    if (channel != nullptr) {
+      pcnt_del_channel(channel);
+    }
+    pcnt_del_unit(unit);
+    return;
+  }
+
+  unit_ = unit;
+}
+
+PulseSnapshot PcntPulseCounter::read(int max_periods) {
+  int value = 0;
+  pcnt_unit_get_count(unit_, &value);
+  int delta = value - last_value_;
+  if (delta < 0) {
+    delta += kPcntLimit;
+  }
+  last_value_ = value;
+  if (delta > 0) {
+    count_ += delta;
+    newest_us_ = micros();
+  }
+
+  PulseSnapshot snapshot;
+  snapshot.count = count_;
+  snapshot.newest_us = newest_us_;
+  return snapshot;
+}
+#endif
+
+PulseCounter* CreatePulseCounter(PulseCounterType type, int pin) {
+#if ESP_IDF_VERSION_MAJOR >= 5
+  if (type == PulseCounterType::kPcnt) {
+    auto counter = new PcntPulseCounter(pin);
+    if (counter->is_valid()) {
+      return counter;
+    }
+    delete counter;
+  }
+#endif
+  return new InterruptPulseCounter(pin);
+}
+
+}  // namespace halmet
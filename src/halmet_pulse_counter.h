@@ -0,0 +1,86 @@
+#ifndef HALMET_SRC_HALMET_PULSE_COUNTER_H_
+#define HALMET_SRC_HALMET_PULSE_COUNTER_H_
+
+#include <Arduino.h>
+#include <esp_idf_version.h>
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include <driver/pulse_cnt.h>
+#endif
+
+#include "pulse_counter.h"
+
+namespace halmet {
+
+enum class PulseCounterType {
+  kInterrupt,  // Timestamps every edge; one interrupt per edge
+  kPcnt,       // Counts in the PCNT peripheral; no CPU cost per edge
+};
+
+/**
+ * @brief Pulse counter timestamping rising edges in an interrupt handler.
+ *
+ * Keeps the times of the last 32 edges in a ring buffer, which allows
+ * period measurement at low frequencies. Each edge costs one interrupt.
+ * Edges within the blanking time after an accepted edge, such as ignition
+ * noise, are dropped in the interrupt handler.
+ */
+class InterruptPulseCounter : public PulseCounter {
+ public:
+  static const int kRingSize = 32;  // Power of two
+
+  explicit InterruptPulseCounter(int pin);
+
+  PulseSnapshot read(int max_periods) override;
+
+  void set_blanking_time(uint32_t blanking_us) override {
+    blanking_us_ = blanking_us;
+  }
+
+ protected:
+  static void IRAM_ATTR edge_isr(void* arg);
+
+  portMUX_TYPE edges_mux_ = portMUX_INITIALIZER_UNLOCKED;
+  uint32_t timestamps_[kRingSize];
+  volatile uint32_t edge_count_ = 0;  // Wraps around
+  volatile int stored_edges_ = 0;     // Valid entries in timestamps_
+  volatile uint32_t blanking_us_ = 0;
+};
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+/**
+ * @brief Pulse counter backed by the ESP32 PCNT peripheral.
+ *
+ * Rising edges are counted in hardware, with a glitch filter, so even
+ * several kHz cost no CPU time. There are no edge timestamps: the time of
+ * the newest edge is approximated by the time of the read that saw the
+ * count change, and frequencies are derived from counts alone. Best suited
+ * to high pulse rates. Read at least every 3 s at 10 kHz so the 15-bit
+ * hardware counter can't wrap unnoticed.
+ *
+ * Uses the IDF 5 pulse counter driver; on older IDF versions
+ * CreatePulseCounter() always returns an interrupt counter.
+ */
+class PcntPulseCounter : public PulseCounter {
+ public:
+  explicit PcntPulseCounter(int pin);
+
+  PulseSnapshot read(int max_periods) override;
+
+  bool is_valid() const { return unit_ != nullptr; }
+
+ protected:
+  pcnt_unit_handle_t unit_ = nullptr;
+  int last_value_ = 0;
+  uint32_t count_ = 0;
+  uint32_t newest_us_ = 0;
+};
+#endif
+
+/// Create a pulse counter of the given type. Falls back to an interrupt
+/// counter if no PCNT unit is available.
+PulseCounter* CreatePulseCounter(PulseCounterType type, int pin);
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_PULSE_COUNTER_H_
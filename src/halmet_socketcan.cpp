@@ -0,0 +1,145 @@
+#include "halmet_socketcan.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// How long CANSendFrame may wait for room in the socket send buffer when
+// the caller asks it to wait.
+static const int kSendWaitMs = 2;
+
+tNMEA2000_socketcan::tNMEA2000_socketcan(const char* interface_name)
+    : tNMEA2000() {
+  strncpy(interface_name_, interface_name, sizeof(interface_name_) - 1);
+  interface_name_[sizeof(interface_name_) - 1] = '\0';
+}
+
+tNMEA2000_socketcan::~tNMEA2000_socketcan() {
+  if (socket_ >= 0) {
+    close(socket_);
+  }
+}
+
+bool tNMEA2000_socketcan::CANOpen() {
+  if (socket_ >= 0) {
+    return true;
+  }
+
+  socket_ = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (socket_ < 0) {
+    perror("socketcan: socket");
+    return false;
+  }
+
+  struct ifreq ifr = {};
+  strncpy(ifr.ifr_name, interface_name_, sizeof(ifr.ifr_name) - 1);
+  if (ioctl(socket_, SIOCGIFINDEX, &ifr) < 0) {
+    fprintf(stderr, "socketcan: no such interface %s\n", interface_name_);
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  // NMEA 2000 only uses extended (29-bit) frames. Let the kernel drop the
+  // rest, together with error frames.
+  struct can_filter filter;
+  filter.can_id = CAN_EFF_FLAG;
+  filter.can_mask = CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG;
+  setsockopt(socket_, SOL_CAN_RAW, CAN_RAW_FILTER, &filter, sizeof(filter));
+
+  struct sockaddr_can addr = {};
+  addr.can_family = AF_CAN;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  if (bind(socket_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    perror("socketcan: bind");
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL, 0) | O_NONBLOCK);
+
+  return true;
+}
+
+bool tNMEA2000_socketcan::CANSendFrame(unsigned long id, unsigned char len,
+                                       const unsigned char* buf,
+                                       bool wait_sent) {
+  if (socket_ < 0) {
+    return false;
+  }
+
+  struct can_frame frame = {};
+  frame.can_id = (id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+  frame.can_dlc = len > 8 ? 8 : len;
+  memcpy(frame.data, buf, frame.can_dlc);
+
+  ssize_t written = write(socket_, &frame, sizeof(frame));
+  if (written < 0 && wait_sent && (errno == EAGAIN || errno == ENOBUFS)) {
+    struct pollfd pfd = {socket_, POLLOUT, 0};
+    if (poll(&pfd, 1, kSendWaitMs) > 0) {
+      written = write(socket_, &frame, sizeof(frame));
+    }
+  }
+
+  if (written != sizeof(frame)) {
+    tx_errors_++;
+    return false;
+  }
+  tx_frames_++;
+  return true;
+}
+
+bool tNMEA2000_socketcan::CANGetFrame(unsigned long& id, unsigned char& len,
+                                      unsigned char* buf) {
+  if (socket_ < 0) {
+    return false;
+  }
+
+  struct can_frame frame;
+  ssize_t nread = read(socket_, &frame, sizeof(frame));
+  if (nread != sizeof(frame)) {
+    return false;
+  }
+
+  id = frame.can_id & CAN_EFF_MASK;
+  len = frame.can_dlc > 8 ? 8 : frame.can_dlc;
+  memcpy(buf, frame.data, len);
+  rx_frames_++;
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+// The NMEA2000 library expects the application to provide the Arduino
+// timing primitives on non-Arduino platforms. micros() is for the HALMET
+// code built into the host program.
+
+extern "C" {
+
+uint32_t millis() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000);
+}
+
+uint32_t micros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+void delay(uint32_t ms) { usleep(ms * 1000); }
+
+}  // extern "C"
+
+#endif  // __linux__ && !ARDUINO
@@ -0,0 +1,48 @@
+#ifndef HALMET_SRC_HALMET_SOCKETCAN_H_
+#define HALMET_SRC_HALMET_SOCKETCAN_H_
+
+// Only meaningful on a Linux host; the firmware builds skip this file.
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <NMEA2000.h>
+#include <net/if.h>
+
+/**
+ * @brief tNMEA2000 backend for Linux SocketCAN interfaces.
+ *
+ * Lets the N2K code run on a developer machine, either against a USB CAN
+ * adapter or a virtual interface:
+ *
+ *   sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+ *
+ * The bus can then be observed and driven with candump/cansend.
+ */
+class tNMEA2000_socketcan : public tNMEA2000 {
+ public:
+  tNMEA2000_socketcan(const char* interface_name = "vcan0");
+  virtual ~tNMEA2000_socketcan();
+
+  // Frame counters, for throughput measurements on the host.
+  unsigned long get_rx_frames() const { return rx_frames_; }
+  unsigned long get_tx_frames() const { return tx_frames_; }
+  unsigned long get_tx_errors() const { return tx_errors_; }
+
+ protected:
+  bool CANSendFrame(unsigned long id, unsigned char len,
+                    const unsigned char* buf, bool wait_sent = true) override;
+  bool CANOpen() override;
+  bool CANGetFrame(unsigned long& id, unsigned char& len,
+                   unsigned char* buf) override;
+
+ private:
+  char interface_name_[IFNAMSIZ];
+  int socket_ = -1;
+
+  unsigned long rx_frames_ = 0;
+  unsigned long tx_frames_ = 0;
+  unsigned long tx_errors_ = 0;
+};
+
+#endif  // __linux__ && !ARDUINO
+
+#endif  // HALMET_SRC_HALMET_SOCKETCAN_H_
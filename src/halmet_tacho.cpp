@@ -0,0 +1,119 @@
+#include "halmet_tacho.h"
+
+#include <algorithm>
+
+#include "halmet_profiler.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+// Smallest deviation from the median treated as an outlier, relative to
+// the median. Lets a steady reading follow real speed changes.
+const float kOutlierMinDeviation = 0.1;
+
+TachoInput::TachoInput(PulseCounter* counter, unsigned int output_interval,
+                       String config_path)
+    : sensesp::FloatSensor(config_path), counter_{counter} {
+  load();
+
+  OnRepeat("Tacho", output_interval, [this]() { update(); });
+}
+
+void TachoInput::update() {
+  int averaged_periods = averaged_periods_;
+  estimator_.set_averaged_periods(averaged_periods);
+  estimator_.set_timeout(timeout_ * 1000);
+
+  // One pulse period at the maximum RPM
+  float max_rpm = max_rpm_;
+  if (max_rpm > 0 && frequency_scale_ != nullptr &&
+      frequency_scale_->get_multiplier() > 0) {
+    counter_->set_blanking_time(60e6f * frequency_scale_->get_multiplier() /
+                                max_rpm);
+  } else {
+    counter_->set_blanking_time(0);
+  }
+
+  PulseSnapshot snapshot = counter_->read(averaged_periods);
+  float frequency = estimator_.update(snapshot, micros());
+
+  outlier_filter_.configure(outlier_window_, outlier_threshold_,
+                            kOutlierMinDeviation);
+  this->emit(outlier_filter_.update(frequency));
+}
+
+bool TachoInput::to_json(JsonObject& root) {
+  root["averaged_periods"] = (int)averaged_periods_;
+  root["timeout"] = (unsigned int)timeout_;
+  root["max_rpm"] = (float)max_rpm_;
+  root["outlier_window"] = (int)outlier_window_;
+  root["outlier_threshold"] = (float)outlier_threshold_;
+  return true;
+}
+
+bool TachoInput::from_json(const JsonObject& config) {
+  if (!config["averaged_periods"].is<int>() ||
+      !config["timeout"].is<unsigned int>()) {
+    return false;
+  }
+  averaged_periods_ = std::min(
+      std::max(config["averaged_periods"].as<int>(), 1), kMaxAveragedPeriods);
+  timeout_ = config["timeout"].as<unsigned int>();
+  // Optional; older configurations don't have them
+  if (config["max_rpm"].is<float>()) {
+    max_rpm_ = config["max_rpm"].as<float>();
+  }
+  if (config["outlier_window"].is<int>()) {
+    outlier_window_ = config["outlier_window"].as<int>();
+  }
+  if (config["outlier_threshold"].is<float>()) {
+    outlier_threshold_ = config["outlier_threshold"].as<float>();
+  }
+  return true;
+}
+
+const String ConfigSchema(const TachoInput& obj) {
+  return R"###({
+    "type": "object",
+    "properties": {
+      "averaged_periods": { "title": "Averaged periods", "type": "integer", "minimum": 1, "maximum": 31, "description": "Number of pulse periods averaged at low frequencies. More periods give a steadier but slower reading." },
+      "timeout": { "title": "Timeout", "type": "integer", "description": "Time without pulses after which the frequency is reported as zero, in milliseconds" },
+      "max_rpm": { "title": "Maximum RPM", "type": "number", "minimum": 0, "description": "Highest possible engine speed. Pulses arriving faster than at this speed are treated as noise and ignored. Calibrate the revolution multiplier first, as the pulse rate limit is derived from it. 0 accepts all pulses." },
+      "outlier_window": { "title": "Outlier window", "type": "integer", "minimum": 1, "maximum": 15, "description": "Number of recent readings a new reading is compared with to detect spikes. Single-reading spikes are removed; a change to a new level shows one reading late. 1 turns spike removal off." },
+      "outlier_threshold": { "title": "Outlier threshold", "type": "number", "minimum": 0, "description": "Deviation from the recent median, in standard deviations, above which a reading is replaced by the median" }
+    }
+  })###";
+}
+
+FrequencyScale::FrequencyScale(float multiplier, String config_path)
+    : sensesp::FloatTransform(config_path), multiplier_{multiplier} {
+  load();
+}
+
+void FrequencyScale::set(const float& input) {
+  this->emit(multiplier_ * input);
+}
+
+bool FrequencyScale::to_json(JsonObject& root) {
+  root["multiplier"] = multiplier_;
+  return true;
+}
+
+bool FrequencyScale::from_json(const JsonObject& config) {
+  if (!config["multiplier"].is<float>()) {
+    return false;
+  }
+  multiplier_ = config["multiplier"];
+  return true;
+}
+
+const String ConfigSchema(const FrequencyScale& obj) {
+  return R"###({
+    "type": "object",
+    "properties": {
+      "multiplier": { "title": "Multiplier", "type": "number", "description": "Output frequency per input pulse frequency, e.g. 1 / pulses per revolution" }
+    }
+  })###";
+}
+
+}  // namespace halmet
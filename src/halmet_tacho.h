@@ -0,0 +1,109 @@
+#ifndef HALMET_SRC_HALMET_TACHO_H_
+#define HALMET_SRC_HALMET_TACHO_H_
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "halmet_pulse_counter.h"
+#include "hampel_filter.h"
+#include "pulse_counter.h"
+#include "sensesp/sensors/sensor.h"
+#include "sensesp/transforms/transform.h"
+
+namespace halmet {
+
+class FrequencyScale;
+
+/**
+ * @brief Pulse frequency input.
+ *
+ * Reads a PulseCounter every output interval and computes the frequency
+ * with a PulseFrequencyEstimator. With an interrupt counter, low
+ * frequencies are measured from the time between edges, at microsecond
+ * resolution rather than one pulse per counting window. With a PCNT
+ * counter, edges cost no CPU time and the frequency comes from the counts.
+ *
+ * Two stages condition the input against spurious edges, e.g. ignition
+ * noise on an alternator W terminal:
+ *
+ * - If a maximum RPM is configured, edges closer together than one period
+ *   at that RPM are blanked in the pulse counter. The maximum pulse rate
+ *   follows from the RPM and the revolution multiplier of the
+ *   FrequencyScale set with set_frequency_scale(), so blanking is off by
+ *   default: with an uncalibrated multiplier it would drop real pulses.
+ * - A Hampel filter over the last few outputs replaces remaining spikes by
+ *   the median. Steady readings pass unchanged; a step to a new speed
+ *   passes one reading late.
+ */
+class TachoInput : public sensesp::FloatSensor {
+ public:
+  static const int kMaxAveragedPeriods = InterruptPulseCounter::kRingSize - 1;
+
+  /**
+   * @param counter Pulse source
+   * @param output_interval Output interval, in ms
+   * @param config_path Configuration path
+   */
+  TachoInput(PulseCounter* counter, unsigned int output_interval = 100,
+             String config_path = "");
+
+  /// Scale relating pulses to revolutions, for the blanking time
+  void set_frequency_scale(FrequencyScale* frequency_scale) {
+    frequency_scale_ = frequency_scale;
+  }
+
+  virtual bool to_json(JsonObject& root) override;
+  virtual bool from_json(const JsonObject& config) override;
+
+ protected:
+  void update();
+
+  PulseCounter* counter_;
+  PulseFrequencyEstimator estimator_;
+  HampelFilter outlier_filter_;
+  FrequencyScale* frequency_scale_ = nullptr;
+
+  // Settings, applied on the event loop
+  std::atomic<int> averaged_periods_{8};
+  std::atomic<unsigned int> timeout_{2000};  // ms
+  std::atomic<float> max_rpm_{0};            // 0 disables blanking
+  std::atomic<int> outlier_window_{5};       // 1 disables the filter
+  std::atomic<float> outlier_threshold_{3};
+};
+
+const String ConfigSchema(const TachoInput& obj);
+
+inline bool ConfigRequiresRestart(const TachoInput& obj) { return false; }
+
+/**
+ * @brief Scales a frequency, e.g. pulses per second to revolutions per
+ * second.
+ *
+ * Uses the same "multiplier" configuration key as SensESP's Frequency
+ * transform, so existing calibrations are kept.
+ */
+class FrequencyScale : public sensesp::FloatTransform {
+ public:
+  FrequencyScale(float multiplier = 1.0, String config_path = "");
+
+  virtual void set(const float& input) override;
+
+  float get_multiplier() const { return multiplier_; }
+
+  virtual bool to_json(JsonObject& root) override;
+  virtual bool from_json(const JsonObject& config) override;
+
+ protected:
+  float multiplier_;
+};
+
+const String ConfigSchema(const FrequencyScale& obj);
+
+inline bool ConfigRequiresRestart(const FrequencyScale& obj) {
+  return false;
+}
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_TACHO_H_
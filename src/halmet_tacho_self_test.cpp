@@ -0,0 +1,197 @@
+#include "halmet_tacho_self_test.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "halmet_profiler.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+// LEDC resolution for the test output. 8 bits allow about 1.2 Hz to 300 kHz.
+const uint8_t kLedcResolution = 8;
+
+TachoSelfTest::TachoSelfTest(int output_pin, float idle_frequency,
+                             FrequencyScale* tacho, String config_path)
+    : sensesp::FileSystemSaveable{config_path},
+      n2k_engine_speed_{0},
+      output_pin_{output_pin},
+      idle_frequency_{idle_frequency},
+      tacho_{tacho},
+      result_status_{"Tacho self-test", "Not run", "Tacho Self-Test", 1100},
+      error_status_{"Max error (%)", 0, "Tacho Self-Test", 1110},
+      settling_status_{"Max settling time (ms)", 0, "Tacho Self-Test", 1120},
+      latency_status_{"Max N2K latency (ms)", 0, "Tacho Self-Test", 1130} {
+  load();
+
+  pinMode(output_pin_, OUTPUT);
+  ledcAttach(output_pin_, idle_frequency_, kLedcResolution);
+  ledcWrite(output_pin_, 1 << (kLedcResolution - 1));  // 50% duty cycle
+
+  tacho_->connect_to(new sensesp::LambdaConsumer<float>(
+      [this](float value) { on_reading(60 * value); }));
+  n2k_engine_speed_.attach(
+      [this]() { on_n2k_engine_speed(n2k_engine_speed_.get()); });
+}
+
+void TachoSelfTest::set_output_frequency(float frequency) {
+  ledcChangeFrequency(output_pin_, frequency, kLedcResolution);
+  ledcWrite(output_pin_, 1 << (kLedcResolution - 1));
+}
+
+void TachoSelfTest::start() {
+  if (is_running()) {
+    return;
+  }
+  if (tacho_->get_multiplier() <= 0) {
+    debugW("Tacho self-test: invalid tacho multiplier");
+    return;
+  }
+  // Settings are fixed for the duration of the test
+  test_steps_ = std::max((int)steps_, 1);
+  test_step_time_ = step_time_;
+  max_error_ = 0;
+  max_settling_ms_ = 0;
+  max_latency_ms_ = -1;
+  passed_ = true;
+  step_ = 0;
+  debugI("Tacho self-test: %d steps of %u ms", test_steps_, test_step_time_);
+  start_step();
+}
+
+void TachoSelfTest::start_step() {
+  float min_rpm = min_rpm_;
+  float max_rpm = max_rpm_;
+  target_rpm_ = min_rpm;
+  if (test_steps_ > 1) {
+    target_rpm_ += (max_rpm - min_rpm) * step_ / (test_steps_ - 1);
+  }
+  settled_ms_ = -1;
+  latency_ms_ = -1;
+  reading_sum_ = 0;
+  reading_count_ = 0;
+
+  char text[32];
+  snprintf(text, sizeof(text), "Running step %d/%d", step_ + 1, test_steps_);
+  result_status_.set(text);
+
+  // The multiplier is revolutions per pulse
+  float frequency = target_rpm_ / 60 / tacho_->get_multiplier();
+  set_output_frequency(frequency);
+  step_start_ms_ = millis();
+  OnDelay("Tacho self-test step", test_step_time_, [this]() { finish_step(); });
+}
+
+unsigned long TachoSelfTest::step_time() { return millis() - step_start_ms_; }
+
+bool TachoSelfTest::is_within_tolerance(float rpm) {
+  return fabsf(rpm - target_rpm_) <= tolerance_ / 100 * target_rpm_;
+}
+
+void TachoSelfTest::on_reading(float rpm) {
+  if (!is_running()) {
+    return;
+  }
+  unsigned long time = step_time();
+  if (is_within_tolerance(rpm)) {
+    if (settled_ms_ < 0) {
+      settled_ms_ = time;
+    }
+  } else {
+    settled_ms_ = -1;
+  }
+  if (time >= test_step_time_ / 2) {
+    reading_sum_ += rpm;
+    reading_count_++;
+  }
+}
+
+void TachoSelfTest::on_n2k_engine_speed(double rpm) {
+  if (is_running() && latency_ms_ < 0 && is_within_tolerance(rpm)) {
+    latency_ms_ = step_time();
+  }
+}
+
+void TachoSelfTest::finish_step() {
+  float measured_rpm = reading_count_ > 0 ? reading_sum_ / reading_count_ : 0;
+  float error = 100 * (measured_rpm - target_rpm_) / target_rpm_;
+  debugI(
+      "Tacho self-test %.0f rpm: measured %.1f rpm (%+.2f%%), settled after "
+      "%ld ms, N2K after %ld ms",
+      target_rpm_, measured_rpm, error, settled_ms_, latency_ms_);
+
+  max_error_ = std::max(max_error_, fabsf(error));
+  if (settled_ms_ < 0 || fabsf(error) > tolerance_) {
+    passed_ = false;
+  } else {
+    max_settling_ms_ = std::max(max_settling_ms_, settled_ms_);
+  }
+  max_latency_ms_ = std::max(max_latency_ms_, latency_ms_);
+
+  if (++step_ < test_steps_) {
+    start_step();
+  } else {
+    finish();
+  }
+}
+
+void TachoSelfTest::finish() {
+  step_ = -1;
+  set_output_frequency(idle_frequency_);
+
+  const char* result = passed_ ? "Passed" : "Failed";
+  debugI("Tacho self-test %s: max error %.2f%%, max settling %ld ms, "
+         "max N2K latency %ld ms", result, max_error_, max_settling_ms_,
+         max_latency_ms_);
+  result_status_.set(result);
+  error_status_.set(max_error_);
+  settling_status_.set(max_settling_ms_);
+  // -1 if no PGN 127488 was sent within the tolerance
+  latency_status_.set(max_latency_ms_);
+}
+
+bool TachoSelfTest::to_json(JsonObject& root) {
+  root["min_rpm"] = (float)min_rpm_;
+  root["max_rpm"] = (float)max_rpm_;
+  root["steps"] = (int)steps_;
+  root["step_time"] = (unsigned int)step_time_;
+  root["tolerance"] = (float)tolerance_;
+  root["start"] = false;
+  return true;
+}
+
+bool TachoSelfTest::from_json(const JsonObject& config) {
+  if (!config["min_rpm"].is<float>() || !config["max_rpm"].is<float>() ||
+      !config["steps"].is<int>() || !config["step_time"].is<unsigned int>() ||
+      !config["tolerance"].is<float>()) {
+    return false;
+  }
+  min_rpm_ = config["min_rpm"].as<float>();
+  max_rpm_ = config["max_rpm"].as<float>();
+  steps_ = config["steps"].as<int>();
+  step_time_ = config["step_time"].as<unsigned int>();
+  tolerance_ = config["tolerance"].as<float>();
+
+  // Never saved as true, so a test only runs on request
+  if (config["start"].is<bool>() && config["start"].as<bool>()) {
+    OnDelay("Tacho self-test start", 0, [this]() { start(); });
+  }
+  return true;
+}
+
+const String ConfigSchema(const TachoSelfTest& obj) {
+  return R"###({
+    "type": "object",
+    "properties": {
+      "min_rpm": { "title": "Lowest speed", "type": "number", "exclusiveMinimum": 0, "description": "Engine speed of the first test step, in RPM" },
+      "max_rpm": { "title": "Highest speed", "type": "number", "exclusiveMinimum": 0, "description": "Engine speed of the last test step, in RPM. Keep it below the maximum RPM of the tacho input." },
+      "steps": { "title": "Steps", "type": "integer", "minimum": 1, "maximum": 50, "description": "Number of speeds tested" },
+      "step_time": { "title": "Step time", "type": "integer", "minimum": 500, "description": "Time each speed is held, in milliseconds" },
+      "tolerance": { "title": "Tolerance", "type": "number", "exclusiveMinimum": 0, "description": "Largest accepted deviation from the generated speed, in percent" },
+      "start": { "title": "Start test", "type": "boolean", "description": "Run the test when the configuration is saved. The test output must be wired to the tacho input. Results are shown on the status page." }
+    }
+  })###";
+}
+
+}  // namespace halmet
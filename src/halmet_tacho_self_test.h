@@ -0,0 +1,104 @@
+#ifndef HALMET_SRC_HALMET_TACHO_SELF_TEST_H_
+#define HALMET_SRC_HALMET_TACHO_SELF_TEST_H_
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "halmet_tacho.h"
+#include "sensesp/system/observablevalue.h"
+#include "sensesp/system/saveable.h"
+#include "sensesp/ui/status_page_item.h"
+
+namespace halmet {
+
+/**
+ * @brief Tacho self-test driving a test output pin with LEDC.
+ *
+ * With the test output wired to a tacho input, the test steps the output
+ * frequency across an RPM range and follows the result through the tacho
+ * pipeline. For every step, it measures:
+ *
+ * - accuracy: the mean reading over the second half of the step, against
+ *   the generated speed
+ * - settling time: from the frequency change until the readings stay within
+ *   the tolerance
+ * - latency: from the frequency change until the first PGN 127488 within the
+ *   tolerance is sent, if n2k_engine_speed_ is connected
+ *
+ * Every step is logged, and the summary is shown on the status page. When no
+ * test runs, the output stays at the idle frequency for manual checks.
+ *
+ * A test is started by setting "start" in the web UI, or with start().
+ */
+class TachoSelfTest : public sensesp::FileSystemSaveable {
+ public:
+  /**
+   * @param output_pin LEDC output pin
+   * @param idle_frequency Output frequency while no test runs, in Hz
+   * @param tacho Tacho output under test, in revolutions per second
+   * @param config_path Configuration path
+   */
+  TachoSelfTest(int output_pin, float idle_frequency, FrequencyScale* tacho,
+                String config_path = "");
+
+  void start();
+  bool is_running() const { return step_ >= 0; }
+
+  virtual bool to_json(JsonObject& root) override;
+  virtual bool from_json(const JsonObject& config) override;
+
+  // Engine speed in each transmitted PGN 127488, in rpm
+  sensesp::ObservableValue<double> n2k_engine_speed_;
+
+ protected:
+  void set_output_frequency(float frequency);
+  void start_step();
+  void finish_step();
+  void finish();
+  void on_reading(float rpm);
+  void on_n2k_engine_speed(double rpm);
+  bool is_within_tolerance(float rpm);
+  unsigned long step_time();
+
+  int output_pin_;
+  float idle_frequency_;
+  FrequencyScale* tacho_;
+
+  // Settings
+  std::atomic<float> min_rpm_{600};
+  std::atomic<float> max_rpm_{3000};
+  std::atomic<int> steps_{6};
+  std::atomic<unsigned int> step_time_{2000};  // ms
+  std::atomic<float> tolerance_{1};            // %
+
+  // Test state; only accessed on the event loop
+  int step_ = -1;
+  int test_steps_;
+  unsigned int test_step_time_;
+  float target_rpm_;
+  unsigned long step_start_ms_;
+  long settled_ms_;  // -1 while outside the tolerance
+  long latency_ms_;  // -1 until a matching PGN 127488
+  double reading_sum_;
+  int reading_count_;
+
+  // Summary over all steps
+  float max_error_;
+  long max_settling_ms_;
+  long max_latency_ms_;
+  bool passed_;
+
+  sensesp::StatusPageItem<String> result_status_;
+  sensesp::StatusPageItem<float> error_status_;
+  sensesp::StatusPageItem<int> settling_status_;
+  sensesp::StatusPageItem<int> latency_status_;
+};
+
+const String ConfigSchema(const TachoSelfTest& obj);
+
+inline bool ConfigRequiresRestart(const TachoSelfTest& obj) { return false; }
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_TACHO_SELF_TEST_H_
@@ -0,0 +1,86 @@
+#include "halmet_tank_filter.h"
+
+#include "halmet_profiler.h"
+#include "sensesp_base_app.h"
+
+namespace halmet {
+
+static const char* kTankFilterModeNames[] = {"None", "EMA", "Low-pass"};
+
+TankSenderFilter::TankSenderFilter(unsigned int sample_interval,
+                                   String config_path)
+    : sensesp::FloatTransform(config_path), sample_interval_{sample_interval} {
+  load();
+  configure();
+}
+
+void TankSenderFilter::configure() {
+  active_mode_ = mode_;
+  active_output_interval_ = output_interval_;
+  median_.set_size(median_window_);
+  float sample_interval_s = sample_interval_ / 1000.0f;
+  ema_.configure(time_constant_, sample_interval_s);
+  // Same time constant for the second-order filter: fc = 1 / (2 pi tau)
+  low_pass_.configure(1 / (2 * PI * time_constant_), 1 / sample_interval_s);
+}
+
+void TankSenderFilter::set(const float& input) {
+  int32_t value = median_.update(FloatToFixedSample(input));
+  switch (active_mode_) {
+    case Mode::kNone:
+      break;
+    case Mode::kEma:
+      value = ema_.update(value);
+      break;
+    case Mode::kLowPass:
+      value = low_pass_.update(value);
+      break;
+  }
+
+  unsigned long now = millis();
+  if (now - last_output_ >= active_output_interval_) {
+    last_output_ = now;
+    this->emit(FixedSampleToFloat(value));
+  }
+}
+
+bool TankSenderFilter::to_json(JsonObject& root) {
+  root["median_window"] = median_window_;
+  root["mode"] = kTankFilterModeNames[(int)mode_];
+  root["time_constant"] = time_constant_;
+  root["output_interval"] = output_interval_;
+  return true;
+}
+
+bool TankSenderFilter::from_json(const JsonObject& config) {
+  if (!config["median_window"].is<int>() || !config["mode"].is<String>() ||
+      !config["time_constant"].is<float>() ||
+      !config["output_interval"].is<unsigned int>()) {
+    return false;
+  }
+  median_window_ = config["median_window"];
+  String mode = config["mode"];
+  for (int i = 0; i < 3; i++) {
+    if (mode == kTankFilterModeNames[i]) {
+      mode_ = (Mode)i;
+    }
+  }
+  time_constant_ = config["time_constant"];
+  output_interval_ = config["output_interval"];
+  OnDelay("Tank filter configure", 0, [this]() { configure(); });
+  return true;
+}
+
+const String ConfigSchema(const TankSenderFilter& obj) {
+  return R"###({
+    "type": "object",
+    "properties": {
+      "median_window": { "title": "Median window", "type": "integer", "minimum": 1, "maximum": 15, "description": "Number of samples in the spike-removing median filter. Use an odd number; 1 disables it." },
+      "mode": { "title": "Smoothing filter", "type": "string", "enum": ["None", "EMA", "Low-pass"], "description": "Exponential moving average or second-order low-pass after the median" },
+      "time_constant": { "title": "Time constant", "type": "number", "description": "Smoothing time constant, in seconds" },
+      "output_interval": { "title": "Output interval", "type": "integer", "description": "Minimum time between output values, in milliseconds" }
+    }
+  })###";
+}
+
+}  // namespace halmet
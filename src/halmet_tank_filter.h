@@ -0,0 +1,71 @@
+#ifndef HALMET_SRC_HALMET_TANK_FILTER_H_
+#define HALMET_SRC_HALMET_TANK_FILTER_H_
+
+#include "fixed_filter.h"
+#include "sensesp/transforms/transform.h"
+
+namespace halmet {
+
+/**
+ * @brief Smooths tank sender readings before the level curve.
+ *
+ * Sloshing makes the sender resistance swing widely around the true level.
+ * Each sample first goes through a running median, which removes spikes,
+ * and then through either an exponential moving average or a second-order
+ * Butterworth low-pass. Both stages run in fixed point on preallocated
+ * state, so the sample rate can be high while the output stays stable.
+ *
+ * The filter runs on every input sample but only emits every
+ * output_interval ms.
+ *
+ * Configuration changes apply without a restart. from_json() may run in
+ * the HTTP server task, so it only updates the settings; the filter state
+ * is rebuilt from them on the event loop, between samples.
+ */
+class TankSenderFilter : public sensesp::FloatTransform {
+ public:
+  enum class Mode { kNone, kEma, kLowPass };
+
+  static const size_t kMaxMedianWindow = 15;
+
+  /**
+   * @param sample_interval Input sample interval, in ms
+   * @param config_path Configuration path
+   */
+  TankSenderFilter(unsigned int sample_interval, String config_path = "");
+
+  virtual void set(const float& input) override;
+
+  virtual bool to_json(JsonObject& root) override;
+  virtual bool from_json(const JsonObject& config) override;
+
+ protected:
+  void configure();
+
+  unsigned int sample_interval_;
+
+  // Settings, as configured
+  int median_window_ = 5;
+  Mode mode_ = Mode::kLowPass;
+  float time_constant_ = 20;             // s
+  unsigned int output_interval_ = 1000;  // ms
+
+  // Settings in use; only accessed on the event loop
+  Mode active_mode_;
+  unsigned int active_output_interval_;
+
+  MedianFilter<kMaxMedianWindow> median_;
+  FixedEmaFilter ema_;
+  FixedBiquadLowPass low_pass_;
+  unsigned long last_output_ = 0;
+};
+
+const String ConfigSchema(const TankSenderFilter& obj);
+
+inline bool ConfigRequiresRestart(const TankSenderFilter& obj) {
+  return false;
+}
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HALMET_TANK_FILTER_H_
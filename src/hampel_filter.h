@@ -0,0 +1,110 @@
+#ifndef HALMET_SRC_HAMPEL_FILTER_H_
+#define HALMET_SRC_HAMPEL_FILTER_H_
+
+#include <algorithm>
+#include <cmath>
+
+namespace halmet {
+
+/**
+ * @brief Causal Hampel outlier filter.
+ *
+ * Keeps the last N samples, including the current one. A sample deviating
+ * from their median by more than threshold times the scaled median
+ * absolute deviation (MAD) is replaced by the median; all other samples
+ * pass unchanged, so a clean signal is not smoothed.
+ *
+ * A deviating sample that agrees with the previous one, which also
+ * deviated, is taken as a step to a new level and passed, as are the
+ * following samples at that level. A real step is thus delayed by one
+ * sample, not by half the window, and only single-sample spikes are
+ * removed.
+ *
+ * The deviation limit never drops below min_deviation times the median,
+ * so that a steady signal with a MAD of zero can still change. State is a
+ * fixed array; each update takes two partial sorts of at most kMaxWindow
+ * floats.
+ */
+class HampelFilter {
+ public:
+  static constexpr int kMaxWindow = 15;
+
+  /**
+   * @param window Number of samples, at most kMaxWindow. 1 or less turns
+   *   the filter off.
+   * @param threshold Deviation limit, in scaled MADs
+   * @param min_deviation Lower bound of the deviation limit, relative to the
+   *   median
+   */
+  void configure(int window, float threshold, float min_deviation) {
+    window = std::min(std::max(window, 1), kMaxWindow);
+    if (window != window_) {
+      window_ = window;
+      reset();
+    }
+    threshold_ = threshold;
+    min_deviation_ = min_deviation;
+  }
+
+  void reset() {
+    size_ = 0;
+    next_ = 0;
+    previous_deviates_ = false;
+  }
+
+  float update(float sample) {
+    samples_[next_] = sample;
+    next_ = (next_ + 1) % window_;
+    if (size_ < window_) {
+      size_++;
+    }
+    if (size_ < 3) {
+      return sample;
+    }
+
+    float sorted[kMaxWindow];
+    std::copy(samples_, samples_ + size_, sorted);
+    float median = Median(sorted, size_);
+    for (int i = 0; i < size_; i++) {
+      sorted[i] = fabsf(samples_[i] - median);
+    }
+    // 1.4826 scales the MAD to a standard deviation for normal noise
+    float limit = threshold_ * 1.4826f * Median(sorted, size_);
+    limit = std::max(limit, min_deviation_ * fabsf(median));
+
+    bool deviates = fabsf(sample - median) > limit;
+    bool step = deviates && previous_deviates_ &&
+                fabsf(sample - previous_) <= limit;
+    previous_ = sample;
+    previous_deviates_ = deviates;
+    if (deviates && !step) {
+      outliers_++;
+      return median;
+    }
+    return sample;
+  }
+
+  /// Number of replaced samples
+  unsigned long get_outliers() const { return outliers_; }
+
+ protected:
+  static float Median(float* values, int size) {
+    std::nth_element(values, values + size / 2, values + size);
+    return values[size / 2];
+  }
+
+  int window_ = 1;
+  float threshold_ = 3;
+  float min_deviation_ = 0;
+
+  float samples_[kMaxWindow];
+  int size_ = 0;
+  int next_ = 0;
+  float previous_ = 0;
+  bool previous_deviates_ = false;
+  unsigned long outliers_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_HAMPEL_FILTER_H_
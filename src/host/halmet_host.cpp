@@ -0,0 +1,158 @@
+// Host-side NMEA 2000 driver for HALMET development.
+//
+// Runs the NMEA 2000 node logic (address claim, product information,
+// ISO requests) on a Linux SocketCAN interface together with the firmware's
+// own engine and tank level senders from n2k_senders.h. They are built
+// against small host stand-ins for the SensESP classes they use (see
+// shim/), fed from a simulated value source, and transmit through the same
+// SendN2kMsg() path as on the device. Incoming messages are counted and
+// the transmit/receive rates are printed once per second, so throughput
+// and latency can be checked with candump/cansend on vcan0 without any
+// hardware.
+//
+// The engine speed is measured from a simulated tacho pulse train with the
+// same estimator as the firmware's tacho input.
+//
+// Usage: halmet_host [interface] [instances]
+//
+// Each instance is a full set of engine and tank senders, so the transmit
+// rate scales with the number of instances.
+
+#include <N2kMessages.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "../halmet_socketcan.h"
+#include "../n2k_senders.h"
+#include "../pulse_counter.h"
+
+namespace {
+
+// Counts received messages and tracks the gap between them.
+class RxCounter : public tNMEA2000::tMsgHandler {
+ public:
+  RxCounter(tNMEA2000* nmea2000) : tNMEA2000::tMsgHandler(0, nmea2000) {}
+
+  unsigned long messages = 0;
+  unsigned long max_gap_ms = 0;
+
+ protected:
+  void HandleMsg(const tN2kMsg& N2kMsg) override {
+    unsigned long now = millis();
+    if (messages > 0 && now - last_rx_ > max_gap_ms) {
+      max_gap_ms = now - last_rx_;
+    }
+    last_rx_ = now;
+    messages++;
+  }
+
+ private:
+  unsigned long last_rx_ = 0;
+};
+
+// The senders of one simulated engine and its fuel tank.
+struct SenderSet {
+  halmet::N2kEngineParameterRapidSender* rapid;
+  halmet::N2kEngineParameterDynamicSender* dynamic;
+  halmet::N2kFluidLevelSender* fluid;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* interface_name = argc > 1 ? argv[1] : "vcan0";
+  unsigned long instances = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1;
+  if (instances < 1) {
+    instances = 1;
+  } else if (instances > 253) {
+    // Engine instances are 0-253
+    instances = 253;
+  }
+
+  auto* nmea2000 = new tNMEA2000_socketcan(interface_name);
+
+  nmea2000->SetN2kCANSendFrameBufSize(250);
+  nmea2000->SetN2kCANReceiveFrameBufSize(250);
+  nmea2000->SetProductInformation("20231229", 104, "HALMET host", "1.0.0",
+                                  "1.0.0");
+  nmea2000->SetDeviceInformation(1, 132, 25, 2046, 4);
+  nmea2000->SetMode(tNMEA2000::N2km_NodeOnly, 71);
+  nmea2000->EnableForward(false);
+
+  auto* rx_counter = new RxCounter(nmea2000);
+  nmea2000->AttachMsgHandler(rx_counter);
+
+  if (!nmea2000->Open()) {
+    fprintf(stderr, "Failed to open %s\n", interface_name);
+    return 1;
+  }
+
+  std::vector<SenderSet> senders;
+  for (unsigned long i = 0; i < instances; i++) {
+    char config_path[40];
+    snprintf(config_path, sizeof(config_path), "/Host/Engine %lu", i);
+    SenderSet set;
+    set.rapid = new halmet::N2kEngineParameterRapidSender(
+        String(config_path) + "/Rapid", i, nmea2000);
+    set.dynamic = new halmet::N2kEngineParameterDynamicSender(
+        String(config_path) + "/Dynamic", i, nmea2000);
+    set.fluid = new halmet::N2kFluidLevelSender(
+        String(config_path) + "/Tank", i & 0x0f, N2kft_Fuel, 200, nmea2000);
+    senders.push_back(set);
+  }
+
+  // Same default as the firmware tacho input
+  const double kPulsesPerRevolution = 100;
+  halmet::SimulatedPulseCounter tacho_pulses;
+  halmet::PulseFrequencyEstimator tacho;
+
+  // Update the inputs at the tacho input's rate, like the firmware does.
+  sensesp::event_loop()->onRepeat(100, [&]() {
+    unsigned long now = millis();
+    // Sweep the engine speed so the values are easy to follow in candump
+    double set_rpm = 600 + (now / 10) % 3000;
+    tacho_pulses.set_frequency(set_rpm / 60 * kPulsesPerRevolution);
+    tacho_pulses.advance_to(now * 1000);
+    halmet::PulseSnapshot pulses =
+        tacho_pulses.read(tacho.get_averaged_periods());
+    double revolutions_per_second =
+        tacho.update(pulses, now * 1000) / kPulsesPerRevolution;
+
+    for (auto& set : senders) {
+      set.rapid->engine_speed_.set(revolutions_per_second);
+      set.dynamic->temperature_->set(273.15 + 80);
+      set.dynamic->oil_pressure_->set(350000);
+      set.dynamic->alternator_potential_->set(14.2);
+      set.dynamic->total_engine_hours_->set(now / 1000);
+      set.fluid->tank_level_.set(0.5);
+    }
+  });
+
+  unsigned long prev_rx_frames = 0;
+  unsigned long prev_tx_frames = 0;
+  unsigned long prev_messages = 0;
+
+  sensesp::event_loop()->onRepeat(1000, [&]() {
+    printf(
+        "rx %lu frames/s %lu msgs/s (max gap %lu ms) | tx %lu frames/s, "
+        "%lu frame errors\n",
+        nmea2000->get_rx_frames() - prev_rx_frames,
+        rx_counter->messages - prev_messages, rx_counter->max_gap_ms,
+        nmea2000->get_tx_frames() - prev_tx_frames, nmea2000->get_tx_errors());
+    fflush(stdout);
+    prev_rx_frames = nmea2000->get_rx_frames();
+    prev_tx_frames = nmea2000->get_tx_frames();
+    prev_messages = rx_counter->messages;
+    rx_counter->max_gap_ms = 0;
+  });
+
+  while (true) {
+    nmea2000->ParseMessages();
+    sensesp::event_loop()->tick();
+
+    // Keep the idle loop from spinning a full core
+    delay(1);
+  }
+}
@@ -0,0 +1,36 @@
+// Host stand-ins for the Arduino core parts used by the HALMET N2K
+// senders. Only what the host build needs; see halmet_host.cpp.
+
+#ifndef HALMET_SRC_HOST_SHIM_ARDUINO_H_
+#define HALMET_SRC_HOST_SHIM_ARDUINO_H_
+
+#include <stdint.h>
+
+#include <string>
+
+// Implemented in halmet_socketcan.cpp
+extern "C" {
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+}
+
+/// Minimal Arduino String: enough for config paths and JSON keys.
+class String {
+ public:
+  String() {}
+  String(const char* str) : str_{str} {}
+  String(const std::string& str) : str_{str} {}
+
+  const char* c_str() const { return str_.c_str(); }
+  unsigned int length() const { return str_.length(); }
+
+  String operator+(const String& other) const { return str_ + other.str_; }
+  String operator+(const char* other) const { return str_ + other; }
+  bool operator==(const String& other) const { return str_ == other.str_; }
+
+ private:
+  std::string str_;
+};
+
+#endif  // HALMET_SRC_HOST_SHIM_ARDUINO_H_
@@ -0,0 +1,22 @@
+// Host stand-in for SensESP's ObservableValue.
+
+#ifndef HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_OBSERVABLEVALUE_H_
+#define HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_OBSERVABLEVALUE_H_
+
+#include "sensesp/system/valueconsumer.h"
+#include "sensesp/system/valueproducer.h"
+
+namespace sensesp {
+
+template <typename T>
+class ObservableValue : public ValueConsumer<T>, public ValueProducer<T> {
+ public:
+  ObservableValue() {}
+  ObservableValue(const T& value) { this->output_ = value; }
+
+  void set(const T& value) override { this->emit(value); }
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_OBSERVABLEVALUE_H_
@@ -0,0 +1,52 @@
+// Host stand-in for SensESP's FileSystemSaveable. Nothing is persisted:
+// load() always fails, so the senders keep their constructor defaults.
+
+#ifndef HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_SAVEABLE_H_
+#define HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_SAVEABLE_H_
+
+#include <Arduino.h>
+
+/// Accepts the ArduinoJson accesses in from_json()/to_json() and ignores
+/// them.
+class JsonVariant {
+ public:
+  template <typename T>
+  bool is() const {
+    return false;
+  }
+  template <typename T>
+  operator T() const {
+    return T{};
+  }
+  template <typename T>
+  JsonVariant& operator=(const T&) {
+    return *this;
+  }
+};
+
+class JsonObject {
+ public:
+  JsonVariant operator[](const char*) const { return JsonVariant(); }
+  JsonVariant operator[](const String&) const { return JsonVariant(); }
+};
+
+namespace sensesp {
+
+class FileSystemSaveable {
+ public:
+  FileSystemSaveable(String config_path) : config_path_{config_path} {}
+  virtual ~FileSystemSaveable() {}
+
+  virtual bool load() { return false; }
+  virtual bool save() { return false; }
+
+  virtual bool from_json(const JsonObject& config) { return false; }
+  virtual bool to_json(JsonObject& config) { return false; }
+
+ protected:
+  String config_path_;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_SAVEABLE_H_
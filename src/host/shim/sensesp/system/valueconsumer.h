@@ -0,0 +1,19 @@
+// Host stand-in for SensESP's ValueConsumer.
+
+#ifndef HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_VALUECONSUMER_H_
+#define HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_VALUECONSUMER_H_
+
+namespace sensesp {
+
+template <typename T>
+class ValueConsumer {
+ public:
+  using input_type = T;
+
+  virtual ~ValueConsumer() {}
+  virtual void set(const T& input) {}
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_VALUECONSUMER_H_
@@ -0,0 +1,57 @@
+// Host stand-in for SensESP's Observable and ValueProducer.
+
+#ifndef HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_VALUEPRODUCER_H_
+#define HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_VALUEPRODUCER_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace sensesp {
+
+class Observable {
+ public:
+  void attach(std::function<void()> observer) {
+    observers_.push_back(observer);
+  }
+
+  void notify() {
+    for (auto& observer : observers_) {
+      observer();
+    }
+  }
+
+ private:
+  std::vector<std::function<void()>> observers_;
+};
+
+template <typename T>
+class ValueProducer : virtual public Observable {
+ public:
+  virtual const T& get() const { return output_; }
+
+  /// Connect a consumer. Returns it, so that transforms can be chained.
+  template <typename C>
+  C* connect_to(C* consumer) {
+    this->attach([this, consumer]() { consumer->set(this->get()); });
+    return consumer;
+  }
+
+  template <typename C>
+  std::shared_ptr<C> connect_to(std::shared_ptr<C> consumer) {
+    this->attach([this, consumer]() { consumer->set(this->get()); });
+    return consumer;
+  }
+
+  void emit(const T& value) {
+    output_ = value;
+    this->notify();
+  }
+
+ protected:
+  T output_{};
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_SRC_HOST_SHIM_SENSESP_SYSTEM_VALUEPRODUCER_H_
@@ -0,0 +1,25 @@
+// Host stand-in for SensESP's LambdaTransform.
+
+#ifndef HALMET_SRC_HOST_SHIM_SENSESP_TRANSFORMS_LAMBDA_TRANSFORM_H_
+#define HALMET_SRC_HOST_SHIM_SENSESP_TRANSFORMS_LAMBDA_TRANSFORM_H_
+
+#include <functional>
+
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+template <typename IN, typename OUT>
+class LambdaTransform : public Transform<IN, OUT> {
+ public:
+  LambdaTransform(std::function<OUT(IN)> function) : function_{function} {}
+
+  void set(const IN& input) override { this->emit(function_(input)); }
+
+ private:
+  std::function<OUT(IN)> function_;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_SRC_HOST_SHIM_SENSESP_TRANSFORMS_LAMBDA_TRANSFORM_H_
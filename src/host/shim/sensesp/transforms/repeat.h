@@ -0,0 +1,28 @@
+// Host stand-in for SensESP's repeating transforms. The host program
+// updates every input continuously, so the values never expire and the
+// repetition is left to the senders' own send intervals.
+
+#ifndef HALMET_SRC_HOST_SHIM_SENSESP_TRANSFORMS_REPEAT_H_
+#define HALMET_SRC_HOST_SHIM_SENSESP_TRANSFORMS_REPEAT_H_
+
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+template <typename T>
+class RepeatExpiring : public Transform<T, T> {
+ public:
+  RepeatExpiring(unsigned long interval, unsigned long max_age) {}
+
+  void set(const T& input) override { this->emit(input); }
+};
+
+template <typename T>
+class RepeatStopping : public RepeatExpiring<T> {
+ public:
+  using RepeatExpiring<T>::RepeatExpiring;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_SRC_HOST_SHIM_SENSESP_TRANSFORMS_REPEAT_H_
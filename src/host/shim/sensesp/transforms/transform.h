@@ -0,0 +1,15 @@
+// Host stand-in for SensESP's Transform.
+
+#ifndef HALMET_SRC_HOST_SHIM_SENSESP_TRANSFORMS_TRANSFORM_H_
+#define HALMET_SRC_HOST_SHIM_SENSESP_TRANSFORMS_TRANSFORM_H_
+
+#include "sensesp/system/observablevalue.h"
+
+namespace sensesp {
+
+template <typename IN, typename OUT>
+class Transform : public ValueConsumer<IN>, public ValueProducer<OUT> {};
+
+}  // namespace sensesp
+
+#endif  // HALMET_SRC_HOST_SHIM_SENSESP_TRANSFORMS_TRANSFORM_H_
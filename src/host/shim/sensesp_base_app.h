@@ -0,0 +1,77 @@
+// Host stand-in for the SensESP event loop and logging macros.
+
+#ifndef HALMET_SRC_HOST_SHIM_SENSESP_BASE_APP_H_
+#define HALMET_SRC_HOST_SHIM_SENSESP_BASE_APP_H_
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#include <functional>
+#include <list>
+
+#define debugE(fmt, ...) fprintf(stderr, "E " fmt "\n", ##__VA_ARGS__)
+#define debugW(fmt, ...) fprintf(stderr, "W " fmt "\n", ##__VA_ARGS__)
+#define debugI(fmt, ...) fprintf(stderr, "I " fmt "\n", ##__VA_ARGS__)
+#define debugD(fmt, ...)
+
+namespace sensesp {
+
+/**
+ * @brief Single-threaded replacement for the ReactESP event loop.
+ *
+ * Repeating and delayed callbacks fire from tick() once their interval has
+ * passed, tick callbacks on every pass.
+ */
+class EventLoop {
+ public:
+  struct Event {
+    uint32_t interval;
+    uint32_t last;
+    bool repeat;
+    std::function<void()> callback;
+  };
+
+  Event* onRepeat(uint32_t interval, std::function<void()> callback) {
+    events_.push_back({interval, millis(), true, callback});
+    return &events_.back();
+  }
+
+  Event* onDelay(uint32_t delay, std::function<void()> callback) {
+    events_.push_back({delay, millis(), false, callback});
+    return &events_.back();
+  }
+
+  Event* onTick(std::function<void()> callback) {
+    return onRepeat(0, callback);
+  }
+
+  void tick() {
+    uint32_t now = millis();
+    for (auto it = events_.begin(); it != events_.end();) {
+      if (now - it->last < it->interval) {
+        ++it;
+        continue;
+      }
+      it->last = now;
+      // Callbacks may add events; std::list keeps the iterator valid.
+      it->callback();
+      if (it->repeat) {
+        ++it;
+      } else {
+        it = events_.erase(it);
+      }
+    }
+  }
+
+ private:
+  std::list<Event> events_;
+};
+
+inline EventLoop* event_loop() {
+  static EventLoop loop;
+  return &loop;
+}
+
+}  // namespace sensesp
+
+#endif  // HALMET_SRC_HOST_SHIM_SENSESP_BASE_APP_H_
@@ -16,7 +16,9 @@
 #define ENABLE_NMEA2000_OUTPUT
 
 #ifdef ENABLE_NMEA2000_OUTPUT
-#include <NMEA2000_esp32.h>
+#include "halmet_n2k_bus.h"
+#include "halmet_n2k_health.h"
+#include "halmet_n2k_rx_task.h"
 #endif
 
 #include "n2k_senders.h"
@@ -32,17 +34,26 @@
 #include "sensesp/ui/config_item.h"
 
 #ifdef ENABLE_SIGNALK
+#include "sensesp/signalk/signalk_put_request_listener.h"
 #include "sensesp_app_builder.h"
 #define BUILDER_CLASS SensESPAppBuilder
 #else
 #include "sensesp_minimal_app_builder.h"
 #endif
 
+#include "halmet_ads1115.h"
+#include "halmet_alarm_manager.h"
 #include "halmet_analog.h"
 #include "halmet_const.h"
+#include "halmet_diagnostics.h"
 #include "halmet_digital.h"
 #include "halmet_display.h"
+#include "halmet_engine_hours.h"
+#include "halmet_fuel_rate.h"
+#include "halmet_i2c.h"
+#include "halmet_profiler.h"
 #include "halmet_serial.h"
+#include "halmet_tacho_self_test.h"
 #include "sensesp/net/http_server.h"
 #include "sensesp/net/networking.h"
 
@@ -65,20 +76,23 @@ std::shared_ptr<SystemStatusLed> system_status_led;
 // Declare some global variables required for the firmware operation.
 
 #ifdef ENABLE_NMEA2000_OUTPUT
-tNMEA2000* nmea2000;
+tNMEA2000_halmet* nmea2000;
+N2kRxTask* n2k_rx_task;
+N2kBusHealthMonitor* n2k_health;
 elapsedMillis n2k_time_since_rx = 0;
 elapsedMillis n2k_time_since_tx = 0;
 #endif
 
 TwoWire* i2c;
-Adafruit_SSD1306* display;
-
-// Store alarm states in an array for local display output
-bool alarm_states[4] = {false, false, false, false};
+DisplayRenderer* display;
+EventLoopStats event_loop_stats;
+AlarmManager* alarm_manager;
 
 // Set the ADS1115 GAIN to adjust the analog input voltage range.
 // On HALMET, this refers to the voltage range of the ADS1115 input
-// AFTER the 33.3/3.3 voltage divider.
+// AFTER the 33.3/3.3 voltage divider. Inputs with automatic gain ranging
+// (the tank senders and ADS1115VoltageInput) start at this gain and adjust
+// it per channel to the signal level.
 
 // GAIN_TWOTHIRDS: 2/3x gain +/- 6.144V  1 bit = 3mV      0.1875mV (default)
 // GAIN_ONE:       1x gain   +/- 4.096V  1 bit = 2mV      0.125mV
@@ -94,6 +108,8 @@ const adsGain_t kADS1115Gain = GAIN_ONE;
 // GPIO 33 will output a pulse wave at 380 Hz with a 50% duty cycle.
 // If this output and GND are connected to one of the digital inputs, it can
 // be used to test that the frequency counter functionality is working.
+// Connected to the D1 tacho input, it also drives the tacho self-test, which
+// is started in the web UI.
 #define ENABLE_TEST_OUTPUT_PIN
 #ifdef ENABLE_TEST_OUTPUT_PIN
 const int kTestOutputPin = GPIO_NUM_33;
@@ -132,28 +148,25 @@ void setup() {
   i2c = new TwoWire(0);
   i2c->begin(kSDAPin, kSCLPin);
 
-  // Initialize ADS1115
-  auto ads1115 = new Adafruit_ADS1115();
-
-  ads1115->setGain(kADS1115Gain);
-  bool ads_initialized = ads1115->begin(kADS1115Address, i2c);
-  debugD("ADS1115 initialized: %d", ads_initialized);
+  // The ADCs and the display share the bus. The scheduler runs ADC
+  // transactions first and sends display updates in short slices.
+  auto i2c_scheduler = new I2CScheduler(i2c);
 
-#ifdef ENABLE_TEST_OUTPUT_PIN
-  pinMode(kTestOutputPin, OUTPUT);
-  // Set the LEDC peripheral to a 13-bit resolution
-  ledcAttach(kTestOutputPin, kTestOutputFrequency, 13);
-  // Set the duty cycle to 50%
-  // Duty cycle value is calculated based on the resolution
-  // For 13-bit resolution, max value is 8191, so 50% is 4096
-  ledcWrite(0, 4096);
-#endif
+  // Initialize the ADS1115 chips. The on-board chip is chip 0; additional
+  // ADS1115 boards on the I2C bus are detected and numbered from 1 in
+  // address order. Each chip's sequencer schedules the conversions of its
+  // channels without blocking the event loop.
+  // EDIT: If the on-board ADS1115 ALERT/RDY output is wired to a GPIO,
+  // pass the pin number as the fourth argument to be notified on
+  // conversion completion instead of polling.
+  auto ads1115_chips =
+      new ADS1115Registry(i2c_scheduler, kADS1115Address, kADS1115Gain);
 
 #ifdef ENABLE_NMEA2000_OUTPUT
   /////////////////////////////////////////////////////////////////////
   // Initialize NMEA 2000 functionality
 
-  nmea2000 = new tNMEA2000_esp32(kCANTxPin, kCANRxPin);
+  nmea2000 = new tNMEA2000_halmet(kCANTxPin, kCANRxPin);
 
   // Reserve enough buffer for sending all messages.
   nmea2000->SetN2kCANSendFrameBufSize(250);
@@ -213,8 +226,14 @@ void setup() {
   nmea2000->EnableForward(false);
   nmea2000->Open();
 
+  // Receive and parse the messages in a dedicated task on core 0. It is
+  // woken by the CAN driver when a frame arrives, so there is no need to
+  // poll ParseMessages() from the event loop. The task starts once all the
+  // message handlers are attached.
+  n2k_rx_task = new N2kRxTask(nmea2000);
+
   auto* nmeaSignalKWifiGateway = new NMEASignalKWifiGateway("/NMEA 2000 To SignalK/", 
-    nmea2000, sensesp_app->get_ws_client()->get_server_address());
+    nmea2000, n2k_rx_task, sensesp_app->get_ws_client()->get_server_address());
   ConfigItem(nmeaSignalKWifiGateway)
     ->set_title("NMEA 2000 To SignalK Gateway")
     ->set_sort_order(40);
@@ -225,8 +244,38 @@ void setup() {
     ->set_title("SignalK Gateway To NMEA 2000")
     ->set_sort_order(50);
 
-  // No need to parse the messages at every single loop iteration; 1 ms will do
-  event_loop()->onRepeat(1, []() { nmea2000->ParseMessages(); });
+  n2k_rx_task->start();
+
+  // Watch the CAN controller error state and recover from bus-off without
+  // a reboot.
+  n2k_health = new N2kBusHealthMonitor(nmea2000);
+
+#ifdef ENABLE_SIGNALK
+  n2k_health->state_name_.connect_to(
+      new SKOutputString("sensors.halmet.nmea2000.state",
+                         "/NMEA 2000/Health/State SK Path"));
+  n2k_health->tx_error_counter_.connect_to(
+      new SKOutputInt("sensors.halmet.nmea2000.txErrorCounter",
+                      "/NMEA 2000/Health/TX Errors SK Path"));
+  n2k_health->rx_error_counter_.connect_to(
+      new SKOutputInt("sensors.halmet.nmea2000.rxErrorCounter",
+                      "/NMEA 2000/Health/RX Errors SK Path"));
+  n2k_health->bus_off_count_.connect_to(
+      new SKOutputInt("sensors.halmet.nmea2000.busOffCount",
+                      "/NMEA 2000/Health/Bus Off Count SK Path"));
+  n2k_health->arb_lost_count_.connect_to(
+      new SKOutputInt("sensors.halmet.nmea2000.arbitrationLostCount",
+                      "/NMEA 2000/Health/Arbitration Lost SK Path"));
+  n2k_health->bus_error_count_.connect_to(
+      new SKOutputInt("sensors.halmet.nmea2000.busErrorCount",
+                      "/NMEA 2000/Health/Bus Errors SK Path"));
+  n2k_health->tx_failed_count_.connect_to(
+      new SKOutputInt("sensors.halmet.nmea2000.txFailedCount",
+                      "/NMEA 2000/Health/TX Failed SK Path"));
+  n2k_health->rx_missed_count_.connect_to(
+      new SKOutputInt("sensors.halmet.nmea2000.rxMissedCount",
+                      "/NMEA 2000/Health/RX Missed SK Path"));
+#endif
 #endif  // ENABLE_NMEA2000_OUTPUT
 
 #ifndef ENABLE_SIGNALK
@@ -238,8 +287,20 @@ void setup() {
   system_status_led = std::make_shared<SystemStatusLed>(LED_BUILTIN);
 #endif
 
+#ifdef HALMET_ENABLE_PROFILER
+  // Serve the event loop callback timings as JSON
+  Profiler::start_server();
+#endif
+
   // Initialize the OLED display
-  bool display_present = InitializeSSD1306(sensesp_app->get(), &display, i2c);
+  display = InitializeSSD1306(sensesp_app->get(), i2c_scheduler);
+  bool display_present = display != nullptr;
+  if (display_present) {
+    ConfigItem(display)
+        ->set_title("Display")
+        ->set_description("OLED display settings")
+        ->set_sort_order(60);
+  }
 
   ///////////////////////////////////////////////////////////////////
   // Analog inputs
@@ -252,11 +313,19 @@ void setup() {
 
   // Connect the tank senders.
   // EDIT: To enable more tanks, uncomment the lines below.
-  auto tank_a1_volume = ConnectTankSender(ads1115, 0, "Fuel", "fuel.main", 3000,
-                                          enable_signalk_output);
-  // auto tank_a2_volume = ConnectTankSender(ads1115, 1, "A2");
-  // auto tank_a3_volume = ConnectTankSender(ads1115, 2, "A3");
-  // auto tank_a4_volume = ConnectTankSender(ads1115, 3, "A4");
+  FloatProducer* fuel_main_volume;
+  auto tank_a1_volume =
+      ConnectTankSender(ads1115_chips->get(0), 0, "Fuel", "fuel.main",
+                        3000, enable_signalk_output, &fuel_main_volume);
+  // auto tank_a2_volume =
+  //     ConnectTankSender(ads1115_chips->get(0), 1, "A2", "a2", 3100);
+  // auto tank_a3_volume =
+  //     ConnectTankSender(ads1115_chips->get(0), 2, "A3", "a3", 3200);
+  // auto tank_a4_volume =
+  //     ConnectTankSender(ads1115_chips->get(0), 3, "A4", "a4", 3300);
+  // Inputs on additional ADS1115 boards are addressed by chip number:
+  // auto tank_b1_volume =
+  //     ConnectTankSender(ads1115_chips->get(1), 0, "B1", "b1", 3400);
 
 #ifdef ENABLE_NMEA2000_OUTPUT
   // Tank 1, instance 0. Capacity 200 liters. You can change the capacity
@@ -280,7 +349,8 @@ void setup() {
   }
 
   // Read the voltage level of analog input A2
-  auto a2_voltage = new ADS1115VoltageInput(ads1115, 1, "/Voltage A2");
+  auto a2_voltage =
+      new ADS1115VoltageInput(ads1115_chips->get(0), 1, "/Voltage A2");
 
   ConfigItem(a2_voltage)
       ->set_title("Analog Voltage A2")
@@ -310,23 +380,57 @@ void setup() {
   ///////////////////////////////////////////////////////////////////
   // Digital alarm inputs
 
+  // The alarm manager passes every alarm state change on to Signal K,
+  // NMEA 2000 and the display right away.
+  alarm_manager = new AlarmManager();
+
   // EDIT: More alarm inputs can be defined by duplicating the lines below.
   // Make sure to not define a pin for both a tacho and an alarm.
   auto alarm_d2_input = ConnectAlarmSender(kDigitalInputPin2, "D2");
   auto alarm_d3_input = ConnectAlarmSender(kDigitalInputPin3, "D3");
   // auto alarm_d4_input = ConnectAlarmSender(kDigitalInputPin4, "D4");
 
-  // Update the alarm states based on the input value changes.
-  // EDIT: If you added more alarm inputs, uncomment the respective lines below.
-  alarm_d2_input->connect_to(
-      new LambdaConsumer<bool>([](bool value) { alarm_states[1] = value; }));
-  // In this example, alarm_d3_input is active low, so invert the value.
-  auto alarm_d3_inverted = alarm_d3_input->connect_to(
-      new LambdaTransform<bool, bool>([](bool value) { return !value; }));
-  alarm_d3_inverted->connect_to(
-      new LambdaConsumer<bool>([](bool value) { alarm_states[2] = value; }));
-  // alarm_d4_input->connect_to(
-  //     new LambdaConsumer<bool>([](bool value) { alarm_states[3] = value; }));
+  // Define the meaning of each alarm input. The polarity, severity and
+  // latching can also be changed in the web UI.
+  // EDIT: If you added more alarm inputs, define an alarm for each of them.
+  auto alarm_d2 = alarm_manager->add_alarm(
+      new Alarm("D2", "Low oil pressure",
+                "notifications.propulsion.main.lowOilPressure",
+                AlarmSeverity::kAlarm, false, false, "/Alarm D2/Alarm"),
+      alarm_d2_input);
+
+  ConfigItem(alarm_d2)
+      ->set_title("Alarm D2")
+      ->set_description("Alarm D2 definition");
+
+  // This is just an example -- normally temperature alarms would not be
+  // active-low.
+  auto alarm_d3 = alarm_manager->add_alarm(
+      new Alarm("D3", "Engine over temperature",
+                "notifications.propulsion.main.overTemperature",
+                AlarmSeverity::kAlarm, true, false, "/Alarm D3/Alarm"),
+      alarm_d3_input);
+
+  ConfigItem(alarm_d3)
+      ->set_title("Alarm D3")
+      ->set_description("Alarm D3 definition");
+
+#ifdef ENABLE_SIGNALK
+  alarm_manager->enable_notifications();
+
+  // Plain alarm.<name> state outputs, next to the notifications
+  ConnectAlarmOutput(alarm_d2);
+  ConnectAlarmOutput(alarm_d3);
+
+  // Acknowledge all alarms with a Signal K PUT request
+  auto alarm_acknowledge =
+      new BoolSKPutRequestListener("notifications.halmet.acknowledge");
+  alarm_acknowledge->connect_to(new LambdaConsumer<bool>([](bool value) {
+    if (value) {
+      alarm_manager->acknowledge_all();
+    }
+  }));
+#endif
 
 #ifdef ENABLE_NMEA2000_OUTPUT
   // EDIT: This example connects the D2 alarm input to the low oil pressure
@@ -340,20 +444,18 @@ void setup() {
       ->set_description("NMEA 2000 dynamic engine parameters for engine 1")
       ->set_sort_order(3010);
 
-  alarm_d2_input->connect_to(engine_dynamic_sender->low_oil_pressure_);
-
-  // This is just an example -- normally temperature alarms would not be
-  // active-low (inverted).
-  alarm_d3_inverted->connect_to(engine_dynamic_sender->over_temperature_);
+  alarm_d2->connect_to(engine_dynamic_sender->low_oil_pressure_);
+  alarm_d3->connect_to(engine_dynamic_sender->over_temperature_);
 #endif  // ENABLE_NMEA2000_OUTPUT
 
-  // FIXME: Transmit the alarms over SK as well.
-
   ///////////////////////////////////////////////////////////////////
   // Digital tacho inputs
 
   // Connect the tacho senders. Engine name is "main".
   // EDIT: More tacho inputs can be defined by duplicating the line below.
+  // For high pulse rates, such as alternator W terminals, pass
+  // PulseCounterType::kPcnt as the third argument to count the pulses in
+  // hardware instead of taking an interrupt per pulse.
   auto tacho_d1_frequency = ConnectTachoSender(kDigitalInputPin1, "main");
 
 #ifdef ENABLE_NMEA2000_OUTPUT
@@ -374,30 +476,144 @@ void setup() {
 
 #endif  // ENABLE_NMEA2000_OUTPUT
 
+#ifdef ENABLE_TEST_OUTPUT_PIN
+  // Sweep the test output across the RPM range and check the D1 tacho
+  // readings and the resulting PGN 127488.
+  auto tacho_self_test = new TachoSelfTest(
+      kTestOutputPin, kTestOutputFrequency, tacho_d1_frequency,
+      "/Tacho main/Self Test");
+
+  ConfigItem(tacho_self_test)
+      ->set_title("Tacho main Self-Test")
+      ->set_description("Tacho measurement check using the test output pin")
+      ->set_sort_order(3016);
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  engine_rapid_sender->sent_engine_speed_.connect_to(
+      &(tacho_self_test->n2k_engine_speed_));
+#endif
+#endif
+
   if (display_present) {
     tacho_d1_frequency->connect_to(new LambdaConsumer<float>(
         [](float value) { PrintValue(display, 3, "RPM D1", 60 * value); }));
   }
 
+  ///////////////////////////////////////////////////////////////////
+  // Fuel consumption
+
+  // Estimate the fuel rate of the main engine from the fuel tank volume.
+  // The tacho input tells the estimator when the engine is stopped.
+  // EDIT: Remove the tacho connection if the tank also feeds other
+  // consumers, such as a heater.
+  auto fuel_rate = new FuelRateEstimator("/Fuel Rate/main");
+
+  ConfigItem(fuel_rate)
+      ->set_title("Main Engine Fuel Rate")
+      ->set_description("Fuel consumption estimated from the fuel tank level")
+      ->set_sort_order(3020);
+
+  fuel_main_volume->connect_to(fuel_rate);
+  tacho_d1_frequency->connect_to(&(fuel_rate->engine_speed_));
+
+#ifdef ENABLE_SIGNALK
+  fuel_rate->connect_to(new SKOutputFloat(
+      "propulsion.main.fuel.rate", "/Fuel Rate/main/SK Path",
+      new SKMetadata("m3/s", "Main engine fuel rate")));
+#endif
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  // PGN 127489 expects l/h
+  fuel_rate
+      ->connect_to(new LambdaTransform<float, float>(
+          [](float value) { return value * 1000 * 3600; }))
+      ->connect_to(engine_dynamic_sender->fuel_rate_);
+#endif
+
+  ///////////////////////////////////////////////////////////////////
+  // Engine hours
+
+  // Count the main engine running time from the tacho input.
+  // EDIT: Set the current hours of an existing hour meter in the web UI.
+  auto engine_hours = new EngineHoursAccumulator("main", "/Engine Hours/main");
+
+  ConfigItem(engine_hours)
+      ->set_title("Main Engine Hours")
+      ->set_description("Engine running time, counted while the tacho "
+                        "shows the engine running")
+      ->set_sort_order(3030);
+
+  tacho_d1_frequency->connect_to(&(engine_hours->engine_speed_));
+
+#ifdef ENABLE_SIGNALK
+  engine_hours
+      ->connect_to(new LambdaTransform<uint32_t, float>(
+          [](uint32_t value) { return value; }))
+      ->connect_to(new SKOutputFloat(
+          "propulsion.main.runTime", "/Engine Hours/main/SK Path",
+          new SKMetadata("s", "Main engine running time")));
+#endif
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  // PGN 127489 engine hours are in seconds as well
+  engine_hours->connect_to(engine_dynamic_sender->total_engine_hours_);
+#endif
+
   ///////////////////////////////////////////////////////////////////
   // Display setup
 
   // Connect the outputs to the display
   if (display_present) {
 #ifdef ENABLE_SIGNALK
-    event_loop()->onRepeat(1000, []() {
+    OnRepeat("Display IP", 1000, []() {
       PrintValue(display, 1, "IP:", WiFi.localIP().toString());
     });
 #endif
 
-    // Create a poor man's "christmas tree" display for the alarms
-    event_loop()->onRepeat(1000, []() {
-      char state_string[5] = {};
-      for (int i = 0; i < 4; i++) {
-        state_string[i] = alarm_states[i] ? '*' : '_';
+    // Create a poor man's "christmas tree" display for the alarms, redrawn
+    // on every alarm state change
+    auto show_alarms = []() {
+      char state_string[DisplayRenderer::kRowChars + 1] = {};
+      int i = 0;
+      for (auto alarm : alarm_manager->get_alarms()) {
+        if (i == DisplayRenderer::kRowChars - 7) {
+          break;
+        }
+        state_string[i++] = alarm->is_active() ? '*' : '_';
       }
       PrintValue(display, 4, "Alarm", state_string);
+    };
+    show_alarms();
+    alarm_manager->add_observer(
+        [show_alarms](const Alarm& alarm) { show_alarms(); });
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+    OnRepeat("Display CAN health", 1000, []() {
+      auto stats = n2k_health->get_stats();
+      char health_string[24];
+      snprintf(health_string, sizeof(health_string), "%s %d/%d",
+               N2kBusStateName(n2k_health->get_state()),
+               stats.error_state.tx_error_counter,
+               stats.error_state.rx_error_counter);
+      PrintValue(display, 5, "CAN", health_string);
     });
+#endif
+
+    // Show the system health on the second page
+    auto diagnostics = new DiagnosticsPage(display, 1, &event_loop_stats);
+    diagnostics->set_alarm_manager(alarm_manager);
+#ifdef ENABLE_NMEA2000_OUTPUT
+    diagnostics->set_nmea2000(nmea2000, n2k_health);
+    diagnostics->set_gateway_drops([nmeaSignalKWifiGateway]() {
+      return nmeaSignalKWifiGateway->get_dropped();
+    });
+#endif
+
+#ifdef BUTTON_BUILTIN
+    // A short press selects the next page. SensESP's button handler keeps
+    // the long presses for restart and factory reset.
+    display->attach_page_button(BUTTON_BUILTIN);
+#endif
   }
 
   // To avoid garbage collecting all shared pointers created in setup(),
@@ -407,4 +623,8 @@ void setup() {
   }
 }
 
-void loop() { event_loop()->tick(); }
+void loop() {
+  unsigned long start = micros();
+  event_loop()->tick();
+  event_loop_stats.record(micros() - start);
+}
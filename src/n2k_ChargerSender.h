@@ -1,6 +1,9 @@
 #include <N2kMessages.h>
 #include <NMEA2000.h>
 
+#include "halmet_n2k_bus.h"
+#include "halmet_profiler.h"
+#include "n2k_standard_layouts.h"
 #include "sensesp/system/saveable.h"
 #include "sensesp/transforms/lambda_transform.h"
 #include "sensesp/transforms/repeat.h"
@@ -21,16 +24,18 @@ class N2kChargerSender : public sensesp::FileSystemSaveable {  // 127507
     this->load();
     this->initialize_members(repeat_interval_, expiry_);
     if (this->enabled_)
-      sensesp::event_loop()->onRepeat(repeat_interval_, [this]() {
+      OnRepeat("N2K 127507", repeat_interval_, [this]() {
         tN2kMsg N2kMsg;
         // At the moment, the PGN is sent regardless of whether all the values
         // are invalid or not.
-        SetN2kChargerStatus(N2kMsg, this->charger_instance_,
-                            this->battery_instance_, this->chargeState->get(),
-                            this->chargerMode->get(), this->enabled->get(),
-                            this->equalizationPending->get(),
-                            this->equalizationTimeRemaining->get());
-        this->nmea2000_->SendMsg(N2kMsg);
+        N2kPGN127507::SetRaw(N2kMsg, this->charger_instance_,
+                             this->battery_instance_,
+                             (uint8_t)this->chargeState->get(),
+                             (uint8_t)this->chargerMode->get(),
+                             (uint8_t)this->enabled->get(),
+                             (uint8_t)this->equalizationPending->get(),
+                             this->equalizationTimeRemaining->raw());
+        SendN2kMsg(this->nmea2000_, N2kMsg);
       });
   }
 
@@ -63,7 +68,7 @@ class N2kChargerSender : public sensesp::FileSystemSaveable {  // 127507
   std::shared_ptr<sensesp::RepeatStopping<tN2kChargerMode>> chargerMode;
   std::shared_ptr<sensesp::RepeatStopping<tN2kOnOff>> enabled;
   std::shared_ptr<sensesp::RepeatStopping<tN2kOnOff>> equalizationPending;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> equalizationTimeRemaining;
+  std::shared_ptr<N2kScaledValue<2, false>> equalizationTimeRemaining;  // 60 s
 
  protected:
   unsigned int repeat_interval_;
@@ -86,8 +91,7 @@ class N2kChargerSender : public sensesp::FileSystemSaveable {  // 127507
     equalizationPending = std::make_shared<sensesp::RepeatStopping<tN2kOnOff>>(
         repeat_interval, expiry);
     equalizationTimeRemaining =
-        std::make_shared<sensesp::RepeatExpiring<double>>(repeat_interval,
-                                                          expiry);
+        std::make_shared<N2kScaledValue<2, false>>(60, expiry);
   }
 };
 
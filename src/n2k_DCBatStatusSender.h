@@ -1,6 +1,9 @@
 #include <N2kMessages.h>
 #include <NMEA2000.h>
 
+#include "halmet_n2k_bus.h"
+#include "halmet_profiler.h"
+#include "n2k_standard_layouts.h"
 #include "sensesp/system/saveable.h"
 #include "sensesp/transforms/lambda_transform.h"
 #include "sensesp/transforms/repeat.h"
@@ -20,14 +23,15 @@ class N2kDCBatStatusSender : public sensesp::FileSystemSaveable {  // 127508
     this->load();
     this->initialize_members(repeat_interval_, expiry_);
     if (this->enabled_)
-      sensesp::event_loop()->onRepeat(repeat_interval_, [this]() {
+      OnRepeat("N2K 127508", repeat_interval_, [this]() {
         tN2kMsg N2kMsg;
         // At the moment, the PGN is sent regardless of whether all the values
         // are invalid or not.
-        SetN2kDCBatStatus(
-            N2kMsg, this->battery_instance_, this->batteryVoltage_->get(),
-            this->batteryCurrent_->get(), this->batteryTemperature_->get());
-        this->nmea2000_->SendMsg(N2kMsg);
+        N2kPGN127508::SetRaw(N2kMsg, this->battery_instance_,
+                             this->batteryVoltage_->raw(),
+                             this->batteryCurrent_->raw(),
+                             this->batteryTemperature_->raw(), 0xff);
+        SendN2kMsg(this->nmea2000_, N2kMsg);
       });
   }
 
@@ -49,9 +53,9 @@ class N2kDCBatStatusSender : public sensesp::FileSystemSaveable {  // 127508
     config["battery_instance"] = battery_instance_;
     return true;
   }
-  std::shared_ptr<sensesp::RepeatExpiring<double>> batteryVoltage_;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> batteryCurrent_;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> batteryTemperature_;
+  std::shared_ptr<N2kScaledValue<2, true>> batteryVoltage_;       // 0.01 V
+  std::shared_ptr<N2kScaledValue<2, true>> batteryCurrent_;       // 0.1 A
+  std::shared_ptr<N2kScaledValue<2, false>> batteryTemperature_;  // 0.01 K
 
  protected:
   unsigned int repeat_interval_;
@@ -63,13 +67,11 @@ class N2kDCBatStatusSender : public sensesp::FileSystemSaveable {  // 127508
 
  private:
   void initialize_members(unsigned int repeat_interval, unsigned int expiry) {
-    // Initialize the RepeatExpiring objects
-    batteryVoltage_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
-    batteryCurrent_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
-    batteryTemperature_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
+    // Initialize the scaled input values
+    batteryVoltage_ = std::make_shared<N2kScaledValue<2, true>>(0.01, expiry);
+    batteryCurrent_ = std::make_shared<N2kScaledValue<2, true>>(0.1, expiry);
+    batteryTemperature_ =
+        std::make_shared<N2kScaledValue<2, false>>(0.01, expiry);
   }
 };
 
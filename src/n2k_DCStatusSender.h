@@ -1,6 +1,9 @@
 #include <N2kMessages.h>
 #include <NMEA2000.h>
 
+#include "halmet_n2k_bus.h"
+#include "halmet_profiler.h"
+#include "n2k_standard_layouts.h"
 #include "sensesp/system/saveable.h"
 #include "sensesp/transforms/lambda_transform.h"
 #include "sensesp/transforms/repeat.h"
@@ -20,15 +23,17 @@ class N2kDCStatusSender : public sensesp::FileSystemSaveable {  // 127506
     this->load();
     this->initialize_members(repeat_interval_, expiry_);
     if (this->enabled_)
-      sensesp::event_loop()->onRepeat(repeat_interval_, [this]() {
+      OnRepeat("N2K 127506", repeat_interval_, [this]() {
         tN2kMsg N2kMsg;
         // At the moment, the PGN is sent regardless of whether all the values
         // are invalid or not.
-        SetN2kDCStatus(N2kMsg, 0, this->battery_instance_, N2kDCt_Battery,
-                       this->stateOfCharge->get(), this->stateOfHealth->get(),
-                       this->timeRemaining->get(), this->rippleVoltage->get(),
-                       this->capacity->get());
-        this->nmea2000_->SendMsg(N2kMsg);
+        N2kPGN127506::SetRaw(N2kMsg, 0, this->battery_instance_,
+                             (uint8_t)N2kDCt_Battery,
+                             this->stateOfCharge->get(),
+                             this->stateOfHealth->get(),
+                             this->timeRemaining->raw(),
+                             this->rippleVoltage->raw(), this->capacity->raw());
+        SendN2kMsg(this->nmea2000_, N2kMsg);
       });
   }
 
@@ -53,9 +58,9 @@ class N2kDCStatusSender : public sensesp::FileSystemSaveable {  // 127506
 
   std::shared_ptr<sensesp::RepeatExpiring<unsigned char>> stateOfCharge;
   std::shared_ptr<sensesp::RepeatExpiring<unsigned char>> stateOfHealth;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> timeRemaining;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> rippleVoltage;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> capacity;
+  std::shared_ptr<N2kScaledValue<2, false>> timeRemaining;  // 60 s
+  std::shared_ptr<N2kScaledValue<2, false>> rippleVoltage;  // 0.001 V
+  std::shared_ptr<N2kScaledValue<2, false>> capacity;       // 3600 C (1 Ah)
 
  protected:
   unsigned int repeat_interval_;
@@ -72,12 +77,10 @@ class N2kDCStatusSender : public sensesp::FileSystemSaveable {  // 127506
         repeat_interval, expiry);
     stateOfHealth = std::make_shared<sensesp::RepeatExpiring<unsigned char>>(
         repeat_interval, expiry);
-    timeRemaining = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
-    rippleVoltage = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
-    capacity = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
+    // Scaled values are converted to their field resolution on update
+    timeRemaining = std::make_shared<N2kScaledValue<2, false>>(60, expiry);
+    rippleVoltage = std::make_shared<N2kScaledValue<2, false>>(0.001, expiry);
+    capacity = std::make_shared<N2kScaledValue<2, false>>(3600, expiry);
   }
 };
 
@@ -1,21 +1,57 @@
 #include <N2kMessages.h>
 #include <NMEA2000.h>
 
+#include "halmet_n2k_bus.h"
+#include "halmet_profiler.h"
+#include "n2k_fixed.h"
+#include "n2k_pgn_layout.h"
 #include "sensesp/system/saveable.h"
 #include "sensesp/transforms/lambda_transform.h"
 #include "sensesp/transforms/repeat.h"
 #include "sensesp_base_app.h"
 
 namespace halmet {
+/// PGN 127751 "DC Voltage/Current"
+using N2kPGN127751 =
+    N2kPgnLayout<127751L, 6,
+                 N2kUIntField<8>,                          // SID
+                 N2kUIntField<8>,                          // Connection number
+                 N2kField<2, false, std::ratio<1, 10>>,    // DC voltage, V
+                 N2kField<3, false, std::ratio<1, 100>>>;  // DC current, A
+
+// Byte-for-byte the same as the former Add2ByteUDouble/Add3ByteUDouble
+// builder, including the N/A and out-of-range values.
+static_assert(N2kBytesEqual(N2kPGN127751::Encode(1, 3, 12.6f, 3.25f),
+                            {0x01, 0x03, 0x7e, 0x00, 0x45, 0x01, 0x00}),
+              "PGN 127751 layout mismatch");
+static_assert(N2kBytesEqual(N2kPGN127751::Encode(0xff, 0, kN2kFloatNA,
+                                                 kN2kFloatNA),
+                            {0xff, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff}),
+              "PGN 127751 N/A mismatch");
+static_assert(N2kBytesEqual(N2kPGN127751::Encode(0, 0, -1.0f, 200000.0f),
+                            {0x00, 0x00, 0xfe, 0xff, 0xfe, 0xff, 0xff}),
+              "PGN 127751 out-of-range mismatch");
+
 void SetN2kPGN127751(tN2kMsg& N2kMsg, unsigned char SID,
                      unsigned char ConnectionNumber, double DcVoltage,
                      double DcCurrent) {
-  N2kMsg.SetPGN(127751L);
-  N2kMsg.Priority = 6;
-  N2kMsg.AddByte(SID);
-  N2kMsg.AddByte(ConnectionNumber);
-  N2kMsg.Add2ByteUDouble(DcVoltage, 0.1);
-  N2kMsg.Add3ByteUDouble(DcCurrent, 0.01);
+  N2kPGN127751::Set(N2kMsg, SID, ConnectionNumber, DcVoltage, DcCurrent);
+}
+
+/// Same as SetN2kPGN127751, with the voltage (0.1 V) and current (0.01 A)
+/// already converted to raw field values.
+void SetN2kPGN127751Raw(tN2kMsg& N2kMsg, unsigned char SID,
+                        unsigned char ConnectionNumber, uint16_t DcVoltageRaw,
+                        uint32_t DcCurrentRaw) {
+  N2kPGN127751::SetRaw(N2kMsg, SID, ConnectionNumber, DcVoltageRaw,
+                       DcCurrentRaw);
+}
+
+inline bool ParseN2kPGN127751(const tN2kMsg& N2kMsg, unsigned char& SID,
+                              unsigned char& ConnectionNumber,
+                              double& DcVoltage, double& DcCurrent) {
+  return N2kPGN127751::Parse(N2kMsg, SID, ConnectionNumber, DcVoltage,
+                             DcCurrent);
 }
 
 /************************************************************************/ /**
@@ -74,16 +110,13 @@ class n2k_DCVoltageCurrentSender
     this->load();
     this->initialize_members(repeat_interval_, expiry_);
     if (this->enabled_)
-      sensesp::event_loop()->onRepeat(repeat_interval_, [this]() {
+      OnRepeat("N2K 127751", repeat_interval_, [this]() {
         tN2kMsg N2kMsg;
         // At the moment, the PGN is sent regardless of whether all the values
         // are invalid or not.
-        SetN2kDCVoltageCurrentStatus(
-            N2kMsg, 0, this->connection_number_, this->DcVoltage->get(),
-            this->DcCurrent->get() > 0
-                ? (double)this->DcCurrent->get()
-                : this->DcPower->get() / this->DcVoltage->get());
-        this->nmea2000_->SendMsg(N2kMsg);
+        SetN2kPGN127751Raw(N2kMsg, 0, this->connection_number_,
+                           this->DcVoltage->raw(), this->get_current_raw());
+        SendN2kMsg(this->nmea2000_, N2kMsg);
       });
   }
 
@@ -106,11 +139,24 @@ class n2k_DCVoltageCurrentSender
     return true;
   }
 
-  std::shared_ptr<sensesp::RepeatExpiring<double>> DcVoltage;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> DcCurrent;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> DcPower;
+  std::shared_ptr<N2kScaledValue<2, false>> DcVoltage;  // 0.1 V
+  std::shared_ptr<N2kScaledValue<3, false>> DcCurrent;  // 0.01 A
+  // Only used to derive the current when no current input is available
+  std::shared_ptr<N2kScaledValue<4, true>> DcPower;  // 1 W
 
  protected:
+  uint32_t get_current_raw() {
+    if (this->DcCurrent->value() > 0) {
+      return this->DcCurrent->raw();
+    }
+    float power = this->DcPower->value();
+    float voltage = this->DcVoltage->value();
+    if (power == N2kFloatNA || voltage == N2kFloatNA || voltage == 0) {
+      return N2kScaledValue<3, false>::Limits::kNA;
+    }
+    return this->DcCurrent->scale(power / voltage);
+  }
+
   unsigned int repeat_interval_;
   unsigned int expiry_;
   tNMEA2000* nmea2000_;
@@ -120,13 +166,10 @@ class n2k_DCVoltageCurrentSender
 
  private:
   void initialize_members(unsigned int repeat_interval, unsigned int expiry) {
-    // Initialize the RepeatExpiring objects
-    DcVoltage = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
-    DcCurrent = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
-    DcPower = std::make_shared<sensesp::RepeatExpiring<double>>(repeat_interval,
-                                                                expiry);
+    // Initialize the scaled input values
+    DcVoltage = std::make_shared<N2kScaledValue<2, false>>(0.1, expiry);
+    DcCurrent = std::make_shared<N2kScaledValue<3, false>>(0.01, expiry);
+    DcPower = std::make_shared<N2kScaledValue<4, true>>(1, expiry);
   }
 };
 
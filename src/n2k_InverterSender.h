@@ -1,6 +1,9 @@
 #include <N2kMessages.h>
 #include <NMEA2000.h>
 
+#include "halmet_n2k_bus.h"
+#include "halmet_profiler.h"
+#include "n2k_pgn_layout.h"
 #include "sensesp/system/saveable.h"
 #include "sensesp/transforms/lambda_transform.h"
 #include "sensesp/transforms/repeat.h"
@@ -16,6 +19,22 @@ enum tN2kInverterOperatingState {
   tN2kInverterOperatingState_Error = 14,       ///< No, Off, Disabled
 };
 
+/// PGN 127509 "Inverter Status"
+using N2kPGN127509 =
+    N2kPgnLayout<127509L, 6,
+                 N2kUIntField<8>,          // Inverter instance
+                 N2kUIntField<8>,          // AC instance
+                 N2kUIntField<8>,          // Battery instance
+                 N2kReservedField<2, 0>,   // Reserved, sent as zero
+                 N2kUIntField<2>,          // Inverter enabled
+                 N2kUIntField<4>>;         // Operating state
+
+static_assert(N2kBytesEqual(
+                  N2kPGN127509::Encode(1, 2, 3, N2kOnOff_On,
+                                       tN2kInverterOperatingState_Disabled),
+                  {0x01, 0x02, 0x03, (4 << 4) | (1 << 2)}),
+              "PGN 127509 layout mismatch");
+
 /************************************************************************/ /**
 * \brief Setting up PGN 127509 Message "Inverter Status"
 * \ingroup group_msgSetUp
@@ -37,13 +56,18 @@ void SetN2kPGN127509(tN2kMsg& N2kMsg, unsigned char InverterInstance,
                      unsigned char ACInstance, unsigned char BatteryInstance,
                      tN2kInverterOperatingState OperatingState,
                      tN2kOnOff InverterEnabled) {
-  N2kMsg.SetPGN(127509L);
-  N2kMsg.Priority = 6;
-  N2kMsg.AddByte(InverterInstance);
-  N2kMsg.AddByte(ACInstance);
-  N2kMsg.AddByte(BatteryInstance);
-  N2kMsg.AddByte((OperatingState & 0x0f) << 4 |
-                 ((InverterEnabled & 0x03) << 2));
+  N2kPGN127509::Set(N2kMsg, InverterInstance, ACInstance, BatteryInstance,
+                    InverterEnabled, OperatingState);
+}
+
+inline bool ParseN2kPGN127509(const tN2kMsg& N2kMsg,
+                              unsigned char& InverterInstance,
+                              unsigned char& ACInstance,
+                              unsigned char& BatteryInstance,
+                              tN2kInverterOperatingState& OperatingState,
+                              tN2kOnOff& InverterEnabled) {
+  return N2kPGN127509::Parse(N2kMsg, InverterInstance, ACInstance,
+                             BatteryInstance, InverterEnabled, OperatingState);
 }
 
 /************************************************************************/ /**
@@ -108,7 +132,7 @@ class N2kInverterSender : public sensesp::FileSystemSaveable {  // 127509
     this->load();
     this->initialize_members(repeat_interval_, expiry_);
     if (this->enabled_)
-      sensesp::event_loop()->onRepeat(repeat_interval_, [this]() {
+      OnRepeat("N2K 127509", repeat_interval_, [this]() {
         tN2kMsg N2kMsg;
         // At the moment, the PGN is sent regardless of whether all the values
         // are invalid or not.
@@ -116,7 +140,7 @@ class N2kInverterSender : public sensesp::FileSystemSaveable {  // 127509
                              this->battery_instance_,
                              this->operatingState->get(),
                              this->inverterEnabled->get());
-        this->nmea2000_->SendMsg(N2kMsg);
+        SendN2kMsg(this->nmea2000_, N2kMsg);
       });
   }
 
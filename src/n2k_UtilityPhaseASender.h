@@ -1,12 +1,41 @@
 #include <N2kMessages.h>
 #include <NMEA2000.h>
 
+#include "halmet_n2k_bus.h"
+#include "halmet_profiler.h"
+#include "n2k_fixed.h"
+#include "n2k_pgn_layout.h"
 #include "sensesp/system/saveable.h"
 #include "sensesp/transforms/lambda_transform.h"
 #include "sensesp/transforms/repeat.h"
 #include "sensesp_base_app.h"
 
 namespace halmet {
+/// PGN 65013 "Utility Phase A AC Power"
+using N2kPGN65013 =
+    N2kPgnLayout<65013L, 6,
+                 N2kField<4, true>,   // Real power, W
+                 N2kField<4, true>>;  // Apparent power, VA
+
+/// PGN 65014 "Utility Phase A Basic AC Quantities"
+using N2kPGN65014 =
+    N2kPgnLayout<65014L, 6,
+                 N2kField<2, false>,                      // Line-line voltage, V
+                 N2kField<2, false>,                      // Line-neutral voltage, V
+                 N2kField<2, false, std::ratio<1, 128>>,  // Frequency, Hz
+                 N2kField<2, false>>;                     // Current, A
+
+// Byte-for-byte the same as the former Add*Double() builders
+static_assert(N2kBytesEqual(N2kPGN65013::Encode(1500.4f, -20.6f),
+                            {0xdc, 0x05, 0x00, 0x00, 0xeb, 0xff, 0xff, 0xff}),
+              "PGN 65013 layout mismatch");
+static_assert(N2kBytesEqual(N2kPGN65013::Encode(kN2kFloatNA, kN2kFloatNA),
+                            {0xff, 0xff, 0xff, 0x7f, 0xff, 0xff, 0xff, 0x7f}),
+              "PGN 65013 N/A mismatch");
+static_assert(N2kBytesEqual(N2kPGN65014::Encode(400.0f, 230.0f, 50.0f, 12.5f),
+                            {0x90, 0x01, 0xe6, 0x00, 0x00, 0x19, 0x0d, 0x00}),
+              "PGN 65014 layout mismatch");
+
 /************************************************************************/ /**
 * \brief Setting up PGN 65013  Message "Utility Phase A AC Power"
 * \ingroup group_msgSetUp
@@ -25,10 +54,19 @@ namespace halmet {
 * \param InverterEnabled      Current in A
 */
 void SetN2kPGN65013(tN2kMsg& N2kMsg, double RealPower, double ApparentPower) {
-  N2kMsg.SetPGN(65013L);
-  N2kMsg.Priority = 6;
-  N2kMsg.Add4ByteDouble(RealPower, 1);
-  N2kMsg.Add4ByteDouble(ApparentPower, 1);
+  N2kPGN65013::Set(N2kMsg, RealPower, ApparentPower);
+}
+
+/// Same as SetN2kPGN65013, with the powers (1 W, 1 VA) already converted to
+/// raw field values.
+void SetN2kPGN65013Raw(tN2kMsg& N2kMsg, int32_t RealPowerRaw,
+                       int32_t ApparentPowerRaw) {
+  N2kPGN65013::SetRaw(N2kMsg, RealPowerRaw, ApparentPowerRaw);
+}
+
+inline bool ParseN2kPGN65013(const tN2kMsg& N2kMsg, double& RealPower,
+                             double& ApparentPower) {
+  return N2kPGN65013::Parse(N2kMsg, RealPower, ApparentPower);
 }
 
 /************************************************************************/ /**
@@ -87,12 +125,27 @@ inline void SetN2kUtilityPhaseAPower(tN2kMsg& N2kMsg, double RealPower,
 void SetN2kPGN65014(tN2kMsg& N2kMsg, double LineLineACRmsVoltage,
                     double LineNeutralACRmsVoltage, double ACFrequency,
                     double ACRmsCurrent) {
-  N2kMsg.SetPGN(65014L);
-  N2kMsg.Priority = 6;
-  N2kMsg.Add2ByteUDouble(LineLineACRmsVoltage, 1);
-  N2kMsg.Add2ByteUDouble(LineNeutralACRmsVoltage, 1);
-  N2kMsg.Add2ByteUDouble(ACFrequency, 0.0078125);
-  N2kMsg.Add2ByteUDouble(ACRmsCurrent, 1);
+  N2kPGN65014::Set(N2kMsg, LineLineACRmsVoltage, LineNeutralACRmsVoltage,
+                   ACFrequency, ACRmsCurrent);
+}
+
+/// Same as SetN2kPGN65014, with the voltages (1 V), frequency (1/128 Hz) and
+/// current (1 A) already converted to raw field values.
+void SetN2kPGN65014Raw(tN2kMsg& N2kMsg, uint16_t LineLineACRmsVoltageRaw,
+                       uint16_t LineNeutralACRmsVoltageRaw,
+                       uint16_t ACFrequencyRaw, uint16_t ACRmsCurrentRaw) {
+  N2kPGN65014::SetRaw(N2kMsg, LineLineACRmsVoltageRaw,
+                      LineNeutralACRmsVoltageRaw, ACFrequencyRaw,
+                      ACRmsCurrentRaw);
+}
+
+inline bool ParseN2kPGN65014(const tN2kMsg& N2kMsg,
+                             double& LineLineACRmsVoltage,
+                             double& LineNeutralACRmsVoltage,
+                             double& ACFrequency, double& ACRmsCurrent) {
+  return N2kPGN65014::Parse(N2kMsg, LineLineACRmsVoltage,
+                            LineNeutralACRmsVoltage, ACFrequency,
+                            ACRmsCurrent);
 }
 
 /************************************************************************/ /**
@@ -158,19 +211,18 @@ class N2kUtilityPhaseASender
     this->load();
     this->initialize_members(repeat_interval_, expiry_);
     if (this->enabled_)
-      sensesp::event_loop()->onRepeat(repeat_interval_, [this]() {
+      OnRepeat("N2K 65013/65014", repeat_interval_, [this]() {
         tN2kMsg N2kMsg, N2kMsg2;
         // At the moment, the PGN is sent regardless of whether all the values
         // are invalid or not.
-        SetN2kUtilityPhaseAPower(N2kMsg, this->RealPower->get(),
-                                 this->ApparentPower->get());
-        this->nmea2000_->SendMsg(N2kMsg, deviceIndex_);
-
-        SetN2kUtilityPhaseABasicACQuantities(
-            N2kMsg2, this->LineLineACRmsVoltage->get(),
-            this->LineNeutralACRmsVoltage->get(), this->ACFrequency->get(),
-            this->ACRmsCurrent->get());
-        this->nmea2000_->SendMsg(N2kMsg2, deviceIndex_);
+        SetN2kPGN65013Raw(N2kMsg, this->RealPower->raw(),
+                          this->ApparentPower->raw());
+        SendN2kMsg(this->nmea2000_, N2kMsg, deviceIndex_);
+
+        SetN2kPGN65014Raw(N2kMsg2, this->LineLineACRmsVoltage->raw(),
+                          this->LineNeutralACRmsVoltage->raw(),
+                          this->ACFrequency->raw(), this->ACRmsCurrent->raw());
+        SendN2kMsg(this->nmea2000_, N2kMsg2, deviceIndex_);
       });
   }
 
@@ -188,12 +240,12 @@ class N2kUtilityPhaseASender
     return true;
   }
 
-  std::shared_ptr<sensesp::RepeatExpiring<double>> RealPower;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> ApparentPower;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> LineLineACRmsVoltage;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> LineNeutralACRmsVoltage;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> ACFrequency;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> ACRmsCurrent;
+  std::shared_ptr<N2kScaledValue<4, true>> RealPower;                // 1 W
+  std::shared_ptr<N2kScaledValue<4, true>> ApparentPower;            // 1 VA
+  std::shared_ptr<N2kScaledValue<2, false>> LineLineACRmsVoltage;    // 1 V
+  std::shared_ptr<N2kScaledValue<2, false>> LineNeutralACRmsVoltage; // 1 V
+  std::shared_ptr<N2kScaledValue<2, false>> ACFrequency;  // 1/128 Hz
+  std::shared_ptr<N2kScaledValue<2, false>> ACRmsCurrent;  // 1 A
 
  protected:
   bool enabled_ = false;
@@ -204,19 +256,14 @@ class N2kUtilityPhaseASender
 
  private:
   void initialize_members(unsigned int repeat_interval, unsigned int expiry) {
-    // Initialize the RepeatExpiring objects
-    RealPower = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
-    ApparentPower = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
-    LineLineACRmsVoltage = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
-    LineNeutralACRmsVoltage = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
-    ACFrequency = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
-    ACRmsCurrent = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
+    // Initialize the scaled input values
+    RealPower = std::make_shared<N2kScaledValue<4, true>>(1, expiry);
+    ApparentPower = std::make_shared<N2kScaledValue<4, true>>(1, expiry);
+    LineLineACRmsVoltage = std::make_shared<N2kScaledValue<2, false>>(1, expiry);
+    LineNeutralACRmsVoltage =
+        std::make_shared<N2kScaledValue<2, false>>(1, expiry);
+    ACFrequency = std::make_shared<N2kScaledValue<2, false>>(0.0078125, expiry);
+    ACRmsCurrent = std::make_shared<N2kScaledValue<2, false>>(1, expiry);
   };
 };
 
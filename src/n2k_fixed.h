@@ -0,0 +1,203 @@
+#ifndef HALMET_SRC_N2K_FIXED_H_
+#define HALMET_SRC_N2K_FIXED_H_
+
+#include <N2kMsg.h>
+
+#include <cstdint>
+#include <type_traits>
+
+#include "expiring_value.h"
+#include "sensesp/system/valueconsumer.h"
+
+namespace halmet {
+
+// Same value as the library's N2kFloatNA, but usable in constant
+// expressions.
+constexpr float kN2kFloatNA = -1e9f;
+
+/**
+ * @brief Raw value limits of an N2K integer field.
+ *
+ * Mirrors the conventions of the NMEA2000 library's Add*Double() methods:
+ * the all-ones value (or the largest positive value for signed fields) is
+ * "not available", the next lower value flags an out-of-range input and
+ * everything below is data.
+ *
+ * @tparam Bytes Field width in bytes (1-4)
+ * @tparam Signed Whether the field is two's complement
+ */
+template <int Bytes, bool Signed>
+struct N2kFieldLimits {
+  static_assert(Bytes >= 1 && Bytes <= 4, "N2K fields are 1 to 4 bytes");
+
+  using raw_type = typename std::conditional<Signed, int32_t, uint32_t>::type;
+
+  static constexpr raw_type kNA =
+      (raw_type)((Signed ? 0x7fffffffUL : 0xffffffffUL) >> (32 - 8 * Bytes));
+  static constexpr raw_type kOutOfRange = kNA - 1;
+  static constexpr raw_type kMax = kNA - 2;
+  static constexpr raw_type kMin = Signed ? -kOutOfRange : 0;
+};
+
+/**
+ * @brief Convert a physical value to a raw N2K field value.
+ *
+ * Single-precision equivalent of the NMEA2000 library's SetBuf*Double():
+ * the value is divided by the field resolution, rounded half away from zero
+ * and range checked. N2kFloatNA maps to the field's "not available" value.
+ *
+ * N2K resolutions are almost always 10^-n or 2^-n, i.e. the inverse is an
+ * integer. In that case the integer part of the value is scaled in fixed
+ * point and only the fractional part goes through the FPU, so fields wider
+ * than the 24-bit float mantissa still get every count right. Otherwise the
+ * conversion is done in float.
+ *
+ * @param value Physical value
+ * @param inv_resolution 1 / field resolution
+ * @param int_inv_resolution inv_resolution if it is an integer, else 0
+ */
+template <int Bytes, bool Signed>
+constexpr typename N2kFieldLimits<Bytes, Signed>::raw_type N2kScale(
+    float value, float inv_resolution, int32_t int_inv_resolution) {
+  using Limits = N2kFieldLimits<Bytes, Signed>;
+  using raw_type = typename Limits::raw_type;
+
+  if (value == kN2kFloatNA) {
+    return Limits::kNA;
+  }
+
+  // Coarse range check; also weeds out NaN and values that would overflow
+  // the integer conversions below.
+  float estimate = value * inv_resolution;
+  if (!(estimate > (float)Limits::kMin - 2.0f &&
+        estimate < (float)Limits::kMax + 2.0f)) {
+    return Limits::kOutOfRange;
+  }
+
+  int64_t scaled = 0;
+  if (int_inv_resolution != 0) {
+    // Truncation keeps the fraction's sign equal to the value's, so rounding
+    // the fraction alone rounds the total half away from zero.
+    int32_t integer_part = (int32_t)value;
+    float remainder = value - (float)integer_part;
+    float fraction = remainder * inv_resolution;
+    int32_t rounded =
+        (int32_t)(fraction >= 0 ? fraction + 0.5f : fraction - 0.5f);
+    if (fraction - (float)(int32_t)fraction == 0.5f ||
+        fraction - (float)(int32_t)fraction == -0.5f) {
+      // The float product landed on a tie, but it may have been rounded
+      // there. The product of two floats is exact in double, so settle
+      // this rare case the way the library's double arithmetic does.
+      double exact = (double)remainder * (double)inv_resolution;
+      if (exact > 0 && exact < (double)fraction) {
+        rounded--;
+      } else if (exact < 0 && exact > (double)fraction) {
+        rounded++;
+      }
+    }
+    scaled = (int64_t)integer_part * int_inv_resolution + rounded;
+  } else {
+    scaled = (int64_t)(estimate >= 0 ? estimate + 0.5f : estimate - 0.5f);
+  }
+
+  if (scaled < Limits::kMin || scaled > Limits::kMax) {
+    return Limits::kOutOfRange;
+  }
+  return (raw_type)scaled;
+}
+
+/// Integer form of an inverse resolution for N2kScale(), or 0 if it is not
+/// an integer. Resolutions like 0.004 or 0.001 have no exact float, so
+/// their inverse is accepted within float rounding of an integer.
+constexpr int32_t N2kIntegerInverse(float inv_resolution) {
+  if (inv_resolution >= 1 && inv_resolution < 2147483648.0f) {
+    int32_t rounded = (int32_t)(inv_resolution + 0.5f);
+    float error = inv_resolution - (float)rounded;
+    if (error <= rounded * 1e-6f && error >= -rounded * 1e-6f) {
+      return rounded;
+    }
+  }
+  return 0;
+}
+
+/// Append a raw field value of the given width to an N2K message.
+template <int Bytes>
+inline void N2kAddRaw(tN2kMsg& N2kMsg, uint32_t raw) {
+  static_assert(Bytes >= 1 && Bytes <= 4, "N2K fields are 1 to 4 bytes");
+  switch (Bytes) {
+    case 1:
+      N2kMsg.AddByte(raw & 0xff);
+      break;
+    case 2:
+      N2kMsg.Add2ByteUInt(raw & 0xffff);
+      break;
+    case 3:
+      N2kMsg.Add3ByteInt(raw & 0xffffff);
+      break;
+    case 4:
+      N2kMsg.Add4ByteUInt(raw);
+      break;
+  }
+}
+
+/**
+ * @brief Consumer that stores an input already converted to its N2K field
+ * representation.
+ *
+ * The conversion happens once, when the input is updated, instead of in
+ * double precision every time the PGN is built. The ESP32 FPU only handles
+ * single precision, so this keeps the soft-float double routines out of
+ * both the update and the send path. The raw value reverts to "not available"
+ * if the input is not updated within the expiry time.
+ */
+template <int Bytes, bool Signed>
+class N2kScaledValue : public sensesp::ValueConsumer<float> {
+ public:
+  using Limits = N2kFieldLimits<Bytes, Signed>;
+  using raw_type = typename Limits::raw_type;
+
+  N2kScaledValue(float resolution, unsigned long expiry)
+      : int_resolution_{N2kIntegerInverse(resolution)},
+        int_inv_resolution_{N2kIntegerInverse(1.0f / resolution)},
+        inv_resolution_{int_inv_resolution_ != 0 ? (float)int_inv_resolution_
+                                                 : 1.0f / resolution},
+        raw_{Limits::kNA, expiry, Limits::kNA},
+        value_{N2kFloatNA, expiry, N2kFloatNA} {}
+
+  virtual void set(const float& value) override {
+    raw_.update(scale(value));
+    value_.update(value);
+  }
+
+  /// Raw field value, or "not available" if expired
+  raw_type raw() const { return raw_.get(); }
+
+  /// Last input value, or N2kFloatNA if expired
+  float value() const { return value_.get(); }
+
+  /// Encode an arbitrary value with this field's resolution
+  raw_type scale(float value) const {
+    if (value == kN2kFloatNA) {
+      return Limits::kNA;
+    }
+    if (int_resolution_ > 1) {
+      // Coarse integer resolution, e.g. 100 Pa: divide, as its inverse has
+      // no exact float. Same as N2kField::encode().
+      return N2kScale<Bytes, Signed>(value / int_resolution_, 1.0f, 1);
+    }
+    return N2kScale<Bytes, Signed>(value, inv_resolution_, int_inv_resolution_);
+  }
+
+  void add_to(tN2kMsg& N2kMsg) const { N2kAddRaw<Bytes>(N2kMsg, raw()); }
+
+ protected:
+  const int32_t int_resolution_;
+  const int32_t int_inv_resolution_;
+  const float inv_resolution_;
+  ExpiringValue<raw_type> raw_;
+  ExpiringValue<float> value_;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_N2K_FIXED_H_
@@ -0,0 +1,312 @@
+#ifndef HALMET_SRC_N2K_PGN_LAYOUT_H_
+#define HALMET_SRC_N2K_PGN_LAYOUT_H_
+
+#include <N2kMsg.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "n2k_fixed.h"
+
+namespace halmet {
+
+/**
+ * @brief Unscaled integer PGN field of any width up to 32 bits.
+ *
+ * Used for instances, SIDs, enumerations and flags. Values are passed
+ * through as-is and truncated to the field width.
+ */
+template <int Bits>
+struct N2kUIntField {
+  static_assert(Bits >= 1 && Bits <= 32, "N2K fields are 1 to 32 bits");
+
+  static constexpr int kBits = Bits;
+  static constexpr bool kReserved = false;
+  using value_type = uint32_t;
+
+  static constexpr uint32_t encode(value_type value) { return value; }
+  static constexpr value_type decode(uint32_t bits) { return bits; }
+};
+
+/**
+ * @brief Reserved PGN bits, always transmitted with a fixed value.
+ *
+ * Reserved fields take no argument in the encoder and decoder calls.
+ */
+template <int Bits, uint32_t Value = (0xffffffffUL >> (32 - Bits))>
+struct N2kReservedField {
+  static_assert(Bits >= 1 && Bits <= 32, "N2K fields are 1 to 32 bits");
+
+  static constexpr int kBits = Bits;
+  static constexpr bool kReserved = true;
+  static constexpr uint32_t kValue = Value;
+};
+
+/**
+ * @brief Scaled numeric PGN field.
+ *
+ * physical value = raw * Resolution + Offset. Encoding follows the NMEA2000
+ * library's Add*Double() conventions (see N2kScale()); decoding maps both
+ * the "not available" and the "out of range" raw values to N2kFloatNA.
+ *
+ * @tparam Bytes Field width in bytes
+ * @tparam Signed Whether the raw value is two's complement
+ * @tparam Resolution std::ratio giving the value of one count
+ * @tparam Offset std::ratio giving the physical value of raw 0
+ */
+template <int Bytes, bool Signed, typename Resolution = std::ratio<1>,
+          typename Offset = std::ratio<0>>
+struct N2kField {
+  using Limits = N2kFieldLimits<Bytes, Signed>;
+  using raw_type = typename Limits::raw_type;
+
+  static constexpr int kBits = 8 * Bytes;
+  static constexpr bool kReserved = false;
+  using value_type = float;
+
+  static constexpr float kResolution = (float)Resolution::num / Resolution::den;
+  static constexpr float kInvResolution =
+      (float)Resolution::den / Resolution::num;
+  static constexpr int32_t kIntInvResolution =
+      Resolution::den % Resolution::num == 0 ? Resolution::den / Resolution::num
+                                             : 0;
+  static constexpr float kOffset = (float)Offset::num / Offset::den;
+
+  static constexpr uint32_t encode(value_type value) {
+    if (value == kN2kFloatNA) {
+      return (uint32_t)Limits::kNA;
+    }
+    if (Resolution::den == 1 && Resolution::num > 1) {
+      // Coarse integer resolution, e.g. 100 Pa. 1/100 has no exact float,
+      // so divide instead of multiplying by the inverse: 150 Pa must give
+      // exactly 1.5 counts to round the same way as the library.
+      return (uint32_t)N2kScale<Bytes, Signed>(
+          (value - kOffset) / (float)Resolution::num, 1.0f, 1);
+    }
+    return (uint32_t)N2kScale<Bytes, Signed>(value - kOffset, kInvResolution,
+                                             kIntInvResolution);
+  }
+
+  static constexpr value_type decode(uint32_t bits) {
+    raw_type raw = (raw_type)bits;
+    if (Signed && Bytes < 4 && (bits & (1UL << (kBits - 1)))) {
+      // Sign extend
+      raw = (raw_type)(bits | ~(0xffffffffUL >> (32 - kBits)));
+    }
+    if (raw == Limits::kNA || raw == Limits::kOutOfRange) {
+      return kN2kFloatNA;
+    }
+    return raw * kResolution + kOffset;
+  }
+};
+
+/**
+ * @brief Compile-time description of a PGN's payload.
+ *
+ * A single list of field descriptors generates the message builder
+ * (Set/SetRaw), the parser (Parse), constexpr encoding for static checks
+ * (Encode/EncodeRaw) and the field offsets for updating a built message in
+ * place (Update). Fields are packed LSB first, as on the bus.
+ *
+ * Arguments are given for every field except the reserved ones, in layout
+ * order. Example:
+ *
+ *   using N2kPGN127751 =
+ *       N2kPgnLayout<127751L, 6, N2kUIntField<8>, N2kUIntField<8>,
+ *                    N2kField<2, false, std::ratio<1, 10>>,
+ *                    N2kField<3, false, std::ratio<1, 100>>>;
+ *
+ *   N2kPGN127751::Set(N2kMsg, sid, connection, voltage, current);
+ */
+template <unsigned long PGN, unsigned char Priority, typename... Fields>
+class N2kPgnLayout {
+ public:
+  static constexpr unsigned long kPGN = PGN;
+  static constexpr unsigned char kPriority = Priority;
+  static constexpr size_t kFieldCount = sizeof...(Fields);
+  static constexpr size_t kDataFieldCount =
+      (0 + ... + (Fields::kReserved ? 0 : 1));
+  static constexpr int kBits = (0 + ... + Fields::kBits);
+  static_assert(kBits % 8 == 0, "PGN layout must fill whole bytes");
+  static constexpr size_t kSize = kBits / 8;
+
+  using Bytes = std::array<uint8_t, kSize>;
+
+  template <size_t I>
+  using Field = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+  /// Bit offset of field I from the start of the payload
+  template <size_t I>
+  static constexpr int bit_offset() {
+    constexpr int bits[] = {Fields::kBits...};
+    int offset = 0;
+    for (size_t i = 0; i < I; i++) {
+      offset += bits[i];
+    }
+    return offset;
+  }
+
+  /// Byte offset of field I; only valid for byte-aligned fields
+  template <size_t I>
+  static constexpr int byte_offset() {
+    static_assert(bit_offset<I>() % 8 == 0, "Field is not byte aligned");
+    return bit_offset<I>() / 8;
+  }
+
+  /// Encode physical field values into payload bytes
+  template <typename... Args>
+  static constexpr Bytes Encode(const Args&... values) {
+    return encode<false>(std::forward_as_tuple(values...),
+                         std::make_index_sequence<kFieldCount>{});
+  }
+
+  /// Encode raw (already scaled) field values into payload bytes
+  template <typename... Args>
+  static constexpr Bytes EncodeRaw(const Args&... raw_values) {
+    return encode<true>(std::forward_as_tuple(raw_values...),
+                        std::make_index_sequence<kFieldCount>{});
+  }
+
+  template <typename... Args>
+  static void Set(tN2kMsg& N2kMsg, const Args&... values) {
+    set_bytes(N2kMsg, Encode(values...));
+  }
+
+  template <typename... Args>
+  static void SetRaw(tN2kMsg& N2kMsg, const Args&... raw_values) {
+    set_bytes(N2kMsg, EncodeRaw(raw_values...));
+  }
+
+  /// Decode a received message into physical field values
+  template <typename... Args>
+  static bool Parse(const tN2kMsg& N2kMsg, Args&... values) {
+    static_assert(sizeof...(Args) == kDataFieldCount,
+                  "Wrong number of PGN field values");
+    if (N2kMsg.PGN != kPGN || N2kMsg.DataLen < (int)kSize) {
+      return false;
+    }
+    Bytes bytes{};
+    for (size_t i = 0; i < kSize; i++) {
+      bytes[i] = N2kMsg.Data[i];
+    }
+    decode(bytes, std::forward_as_tuple(values...),
+           std::make_index_sequence<kFieldCount>{});
+    return true;
+  }
+
+  /// Overwrite field I of an already built message with a new value
+  template <size_t I>
+  static void Update(tN2kMsg& N2kMsg,
+                     typename Field<I>::value_type value) {
+    static_assert(!Field<I>::kReserved, "Cannot update a reserved field");
+    put_bits(N2kMsg.Data, bit_offset<I>(), Field<I>::kBits,
+             Field<I>::encode(value));
+  }
+
+ protected:
+  /// Index of field I in the argument list, i.e. not counting reserved
+  /// fields
+  template <size_t I>
+  static constexpr size_t data_index() {
+    constexpr bool reserved[] = {Fields::kReserved...};
+    size_t index = 0;
+    for (size_t i = 0; i < I; i++) {
+      index += reserved[i] ? 0 : 1;
+    }
+    return index;
+  }
+
+  template <typename Buffer>
+  static constexpr void put_bits(Buffer& buf, int offset, int bits,
+                                 uint32_t value) {
+    for (int i = 0; i < bits;) {
+      int byte = (offset + i) / 8;
+      int shift = (offset + i) % 8;
+      int n = 8 - shift < bits - i ? 8 - shift : bits - i;
+      uint8_t mask = (uint8_t)(((1U << n) - 1) << shift);
+      buf[byte] = (uint8_t)((buf[byte] & ~mask) | (((value >> i) << shift) & mask));
+      i += n;
+    }
+  }
+
+  static constexpr uint32_t get_bits(const Bytes& buf, int offset, int bits) {
+    uint32_t value = 0;
+    for (int i = 0; i < bits;) {
+      int byte = (offset + i) / 8;
+      int shift = (offset + i) % 8;
+      int n = 8 - shift < bits - i ? 8 - shift : bits - i;
+      value |= (uint32_t)((buf[byte] >> shift) & ((1U << n) - 1)) << i;
+      i += n;
+    }
+    return value;
+  }
+
+  template <bool Raw, typename Tuple, size_t... I>
+  static constexpr Bytes encode(const Tuple& args, std::index_sequence<I...>) {
+    static_assert(std::tuple_size<Tuple>::value == kDataFieldCount,
+                  "Wrong number of PGN field values");
+    Bytes bytes{};
+    (put_field<Raw, I>(bytes, args), ...);
+    return bytes;
+  }
+
+  template <bool Raw, size_t I, typename Tuple>
+  static constexpr void put_field(Bytes& bytes, const Tuple& args) {
+    using F = Field<I>;
+    uint32_t bits = 0;
+    if constexpr (F::kReserved) {
+      bits = F::kValue;
+    } else if constexpr (Raw) {
+      bits = (uint32_t)std::get<data_index<I>()>(args);
+    } else {
+      bits = F::encode(
+          (typename F::value_type)std::get<data_index<I>()>(args));
+    }
+    put_bits(bytes, bit_offset<I>(), F::kBits, bits);
+  }
+
+  template <typename Tuple, size_t... I>
+  static void decode(const Bytes& bytes, Tuple&& values,
+                     std::index_sequence<I...>) {
+    (get_field<I>(bytes, values), ...);
+  }
+
+  template <size_t I, typename Tuple>
+  static void get_field(const Bytes& bytes, Tuple& values) {
+    using F = Field<I>;
+    if constexpr (!F::kReserved) {
+      auto& value = std::get<data_index<I>()>(values);
+      value = static_cast<std::remove_reference_t<decltype(value)>>(
+          F::decode(get_bits(bytes, bit_offset<I>(), F::kBits)));
+    }
+  }
+
+  static void set_bytes(tN2kMsg& N2kMsg, const Bytes& bytes) {
+    N2kMsg.SetPGN(kPGN);
+    N2kMsg.Priority = kPriority;
+    for (uint8_t byte : bytes) {
+      N2kMsg.AddByte(byte);
+    }
+  }
+};
+
+/// Constexpr comparison of encoded payloads, for static_assert checks
+template <size_t N>
+constexpr bool N2kBytesEqual(const std::array<uint8_t, N>& a,
+                             const std::array<uint8_t, N>& b) {
+  for (size_t i = 0; i < N; i++) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_N2K_PGN_LAYOUT_H_
@@ -10,6 +10,9 @@
 #include <n2k_UtilityPhaseASender.h>
 #include <n2k_DCVoltageCurrentSender.h>
 
+#include "halmet_n2k_bus.h"
+#include "halmet_profiler.h"
+#include "n2k_standard_layouts.h"
 #include "sensesp/system/saveable.h"
 #include "sensesp/transforms/lambda_transform.h"
 #include "sensesp/transforms/repeat.h"
@@ -32,18 +35,20 @@ class N2kEngineParameterRapidSender : public sensesp::FileSystemSaveable {
         expiry_{1000}           // In ms. When the inputs expire.
   {
     this->initialize_members(repeat_interval_, expiry_);
-    sensesp::event_loop()->onRepeat(repeat_interval_, [this]() {
+    OnRepeat("N2K 127488", repeat_interval_, [this]() {
       tN2kMsg N2kMsg;
       // At the moment, the PGN is sent regardless of whether all the values
       // are invalid or not.
-      SetN2kEngineParamRapid(
-          N2kMsg, this->engine_instance_, this->engine_speed_rpm_->get(),
-          this->engine_boost_pressure_->get(), this->engine_tilt_trim_->get());
-      this->nmea2000_->SendMsg(N2kMsg);
+      N2kPGN127488::SetRaw(N2kMsg, this->engine_instance_,
+                           this->engine_speed_rpm_->raw(),
+                           this->engine_boost_pressure_->raw(),
+                           (uint8_t)this->engine_tilt_trim_->get());
+      SendN2kMsg(this->nmea2000_, N2kMsg);
+      sent_engine_speed_.set(this->engine_speed_rpm_->value());
     });
 
     engine_speed_
-        .connect_to(new sensesp::LambdaTransform<double, double>(
+        .connect_to(new sensesp::LambdaTransform<double, float>(
             [](double value) { return 60 * value; }))
         ->connect_to(engine_speed_rpm_);
   }
@@ -63,27 +68,29 @@ class N2kEngineParameterRapidSender : public sensesp::FileSystemSaveable {
 
   sensesp::ObservableValue<double>
       engine_speed_;  // Connected to engine_speed_rpm_
-  std::shared_ptr<sensesp::RepeatExpiring<double>> engine_boost_pressure_;
+  std::shared_ptr<N2kScaledValue<2, false>> engine_boost_pressure_;  // 100 Pa
   std::shared_ptr<sensesp::RepeatExpiring<int8_t>> engine_tilt_trim_;
 
+  // Engine speed in each transmitted message, in rpm
+  sensesp::ObservableValue<double> sent_engine_speed_;
+
  protected:
   unsigned int repeat_interval_;
   unsigned int expiry_;
   tNMEA2000* nmea2000_;
 
-  std::shared_ptr<sensesp::RepeatExpiring<double>> engine_speed_rpm_;
+  std::shared_ptr<N2kScaledValue<2, false>> engine_speed_rpm_;  // 0.25 rpm
 
   uint8_t engine_instance_ = 0;
 
  private:
   void initialize_members(unsigned int repeat_interval, unsigned int expiry) {
-    // Initialize the RepeatExpiring objects
-    engine_boost_pressure_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
+    // Scaled values are converted to their field resolution on update
+    engine_boost_pressure_ =
+        std::make_shared<N2kScaledValue<2, false>>(100, expiry);
     engine_tilt_trim_ = std::make_shared<sensesp::RepeatExpiring<int8_t>>(
         repeat_interval, expiry);
-    engine_speed_rpm_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval, expiry);
+    engine_speed_rpm_ = std::make_shared<N2kScaledValue<2, false>>(0.25, expiry);
   }
 };
 
@@ -112,29 +119,32 @@ class N2kEngineParameterDynamicSender : public sensesp::FileSystemSaveable {
   {
     this->initialize_members(repeat_interval_, expiry_);
 
-    sensesp::event_loop()->onRepeat(repeat_interval_, [this]() {
-      tN2kMsg N2kMsg;
-      SetN2kEngineDynamicParam(
-          N2kMsg, this->engine_instance_, this->oil_pressure_->get(),
-          this->oil_temperature_->get(), this->temperature_->get(),
-          this->alternator_potential_->get(), this->fuel_rate_->get(),
-          this->total_engine_hours_->get(), this->coolant_pressure_->get(),
-          this->fuel_pressure_->get(), this->engine_load_->get(),
-          this->engine_torque_->get(), this->get_engine_status_1(),
-          this->get_engine_status_2());
-      this->nmea2000_->SendMsg(N2kMsg);
-    });
+    OnRepeat("N2K 127489", repeat_interval_, [this]() { send(); });
+
+    // Send right away when an engine status bit changes, so that alarms
+    // don't wait for the next transmission interval.
+    for (auto& status_bit :
+         {check_engine_, over_temperature_, low_oil_pressure_, low_oil_level_,
+          low_fuel_pressure_, low_system_voltage_, low_coolant_level_,
+          water_flow_, water_in_fuel_, charge_indicator_, preheat_indicator_,
+          high_boost_pressure_, rev_limit_exceeded_, egr_system_,
+          throttle_position_sensor_, emergency_stop_, warning_level_1_,
+          warning_level_2_, power_reduction_, maintenance_needed_,
+          engine_comm_error_, sub_or_secondary_throttle_,
+          neutral_start_protect_, engine_shutting_down_}) {
+      status_bit->attach([this]() { this->schedule_status_send(); });
+    }
   }
 
   // Data to be transmitted
-  std::shared_ptr<sensesp::RepeatExpiring<double>> oil_pressure_;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> oil_temperature_;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> temperature_;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> alternator_potential_;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> fuel_rate_;
+  std::shared_ptr<N2kScaledValue<2, false>> oil_pressure_;          // 100 Pa
+  std::shared_ptr<N2kScaledValue<2, false>> oil_temperature_;       // 0.1 K
+  std::shared_ptr<N2kScaledValue<2, false>> temperature_;           // 0.01 K
+  std::shared_ptr<N2kScaledValue<2, true>> alternator_potential_;   // 0.01 V
+  std::shared_ptr<N2kScaledValue<2, true>> fuel_rate_;              // 0.1 l/h
   std::shared_ptr<sensesp::RepeatExpiring<uint32_t>> total_engine_hours_;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> coolant_pressure_;
-  std::shared_ptr<sensesp::RepeatExpiring<double>> fuel_pressure_;
+  std::shared_ptr<N2kScaledValue<2, false>> coolant_pressure_;      // 100 Pa
+  std::shared_ptr<N2kScaledValue<2, false>> fuel_pressure_;         // 1000 Pa
   std::shared_ptr<sensesp::RepeatExpiring<int>> engine_load_;
   std::shared_ptr<sensesp::RepeatExpiring<int>> engine_torque_;
   // Engine status 1 fields
@@ -225,31 +235,64 @@ class N2kEngineParameterDynamicSender : public sensesp::FileSystemSaveable {
     return status;
   }
 
+  void send() {
+    tN2kMsg N2kMsg;
+    tN2kEngineDiscreteStatus1 status_1 = this->get_engine_status_1();
+    tN2kEngineDiscreteStatus2 status_2 = this->get_engine_status_2();
+    N2kPGN127489::SetRaw(
+        N2kMsg, this->engine_instance_, this->oil_pressure_->raw(),
+        this->oil_temperature_->raw(), this->temperature_->raw(),
+        this->alternator_potential_->raw(), this->fuel_rate_->raw(),
+        this->total_engine_hours_->get(), this->coolant_pressure_->raw(),
+        this->fuel_pressure_->raw(), status_1.Status, status_2.Status,
+        (uint8_t)this->engine_load_->get(),
+        (uint8_t)this->engine_torque_->get());
+    SendN2kMsg(this->nmea2000_, N2kMsg);
+    sent_status_1_ = status_1.Status;
+    sent_status_2_ = status_2.Status;
+  }
+
+  // Status bits are emitted individually and repeated every interval;
+  // coalesce the changes of one event loop pass into at most one send.
+  void schedule_status_send() {
+    if (status_send_pending_) {
+      return;
+    }
+    status_send_pending_ = true;
+    OnDelay("N2K 127489 status", 0, [this]() {
+      status_send_pending_ = false;
+      if (this->get_engine_status_1().Status != sent_status_1_ ||
+          this->get_engine_status_2().Status != sent_status_2_) {
+        send();
+      }
+    });
+  }
+
   unsigned int repeat_interval_;
   unsigned int expiry_;
   tNMEA2000* nmea2000_;
 
   uint8_t engine_instance_;
 
+  uint16_t sent_status_1_ = 0;
+  uint16_t sent_status_2_ = 0;
+  bool status_send_pending_ = false;
+
  private:
   void initialize_members(uint32_t repeat_interval_, uint32_t expiry_) {
-    // Initialize all RepeatExpiring members
-    oil_pressure_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval_, expiry_);
-    oil_temperature_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval_, expiry_);
-    temperature_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval_, expiry_);
-    alternator_potential_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval_, expiry_);
-    fuel_rate_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval_, expiry_);
+    // Scaled values are converted to their field resolution on update
+    oil_pressure_ = std::make_shared<N2kScaledValue<2, false>>(100, expiry_);
+    oil_temperature_ = std::make_shared<N2kScaledValue<2, false>>(0.1, expiry_);
+    temperature_ = std::make_shared<N2kScaledValue<2, false>>(0.01, expiry_);
+    alternator_potential_ =
+        std::make_shared<N2kScaledValue<2, true>>(0.01, expiry_);
+    fuel_rate_ = std::make_shared<N2kScaledValue<2, true>>(0.1, expiry_);
     total_engine_hours_ = std::make_shared<sensesp::RepeatExpiring<uint32_t>>(
         repeat_interval_, expiry_);
-    coolant_pressure_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval_, expiry_);
-    fuel_pressure_ = std::make_shared<sensesp::RepeatExpiring<double>>(
-        repeat_interval_, expiry_);
+    coolant_pressure_ =
+        std::make_shared<N2kScaledValue<2, false>>(100, expiry_);
+    fuel_pressure_ = std::make_shared<N2kScaledValue<2, false>>(1000, expiry_);
+    // Integer fields are sent as they are
     engine_load_ = std::make_shared<sensesp::RepeatExpiring<int>>(
         repeat_interval_, expiry_);
     engine_torque_ = std::make_shared<sensesp::RepeatExpiring<int>>(
@@ -332,18 +375,20 @@ class N2kFluidLevelSender : public sensesp::FileSystemSaveable {
         repeat_interval_{2500},  // In ms. Dictated by NMEA 2000 standard!
         expiry_{10000}           // In ms. When the inputs expire.
   {
+    this->set_tank_capacity(tank_capacity);
     tank_level_
-        .connect_to(new sensesp::LambdaTransform<double, double>(
+        .connect_to(new sensesp::LambdaTransform<double, float>(
             [this](double value) { return 100 * value; }))
         ->connect_to(&tank_level_percent_);
 
-    sensesp::event_loop()->onRepeat(repeat_interval_, [this]() {
+    OnRepeat("N2K 127505", repeat_interval_, [this]() {
       tN2kMsg N2kMsg;
       // At the moment, the PGN is sent regardless of whether all the values
       // are invalid or not.
-      SetN2kFluidLevel(N2kMsg, this->tank_instance_, this->tank_type_,
-                       this->tank_level_percent_.get(), this->tank_capacity_);
-      this->nmea2000_->SendMsg(N2kMsg);
+      N2kPGN127505::SetRaw(N2kMsg, this->tank_instance_, this->tank_type_,
+                           this->tank_level_percent_.raw(),
+                           this->tank_capacity_raw_);
+      SendN2kMsg(this->nmea2000_, N2kMsg);
     });
   }
 
@@ -358,7 +403,8 @@ class N2kFluidLevelSender : public sensesp::FileSystemSaveable {
     }
     tank_instance_ = config["tank_instance"];
     tank_type_ = config["tank_type"];
-    tank_capacity_ = config["tank_capacity"];
+    double tank_capacity = config["tank_capacity"];
+    set_tank_capacity(tank_capacity);
     return true;
   }
 
@@ -378,9 +424,14 @@ class N2kFluidLevelSender : public sensesp::FileSystemSaveable {
 
   uint8_t tank_instance_;
   tN2kFluidType tank_type_;
+  void set_tank_capacity(double capacity) {
+    tank_capacity_ = capacity;
+    tank_capacity_raw_ = N2kPGN127505::Field<3>::encode(capacity);
+  }
+
   double tank_capacity_;  // in liters
-  sensesp::RepeatExpiring<double> tank_level_percent_{repeat_interval_,
-                                                      expiry_};
+  uint32_t tank_capacity_raw_;
+  N2kScaledValue<2, true> tank_level_percent_{0.004, expiry_};  // 0.004 %
 };
 
 const String ConfigSchema(const N2kFluidLevelSender& obj) {
@@ -0,0 +1,107 @@
+#ifndef HALMET_SRC_N2K_STANDARD_LAYOUTS_H_
+#define HALMET_SRC_N2K_STANDARD_LAYOUTS_H_
+
+#include <ratio>
+
+#include "n2k_pgn_layout.h"
+
+namespace halmet {
+
+// Layouts of the standard PGNs sent by the senders in n2k_senders.h. They
+// produce the same bytes as the NMEA2000 library's SetN2kPGN* builders
+// (see test/test_n2k_pgn_layout), but in single precision.
+
+/// PGN 127488 "Engine Parameters, Rapid Update"
+using N2kPGN127488 =
+    N2kPgnLayout<127488L, 2,
+                 N2kUIntField<8>,                       // Engine instance
+                 N2kField<2, false, std::ratio<1, 4>>,  // Engine speed, rpm
+                 N2kField<2, false, std::ratio<100>>,   // Boost pressure, Pa
+                 N2kUIntField<8>,                       // Tilt/trim, %
+                 N2kReservedField<16>>;
+
+/// PGN 127489 "Engine Parameters, Dynamic"
+using N2kPGN127489 =
+    N2kPgnLayout<127489L, 2,
+                 N2kUIntField<8>,                         // Engine instance
+                 N2kField<2, false, std::ratio<100>>,     // Oil pressure, Pa
+                 N2kField<2, false, std::ratio<1, 10>>,   // Oil temp., K
+                 N2kField<2, false, std::ratio<1, 100>>,  // Coolant temp., K
+                 N2kField<2, true, std::ratio<1, 100>>,   // Alternator, V
+                 N2kField<2, true, std::ratio<1, 10>>,    // Fuel rate, l/h
+                 // Engine hours, s. Already an integer, and beyond 2^24 s
+                 // a float would lose seconds.
+                 N2kUIntField<32>,
+                 N2kField<2, false, std::ratio<100>>,   // Coolant press., Pa
+                 N2kField<2, false, std::ratio<1000>>,  // Fuel pressure, Pa
+                 N2kReservedField<8>,
+                 N2kUIntField<16>,  // Discrete status 1
+                 N2kUIntField<16>,  // Discrete status 2
+                 N2kUIntField<8>,   // Engine load, %
+                 N2kUIntField<8>>;  // Engine torque, %
+
+/// PGN 127505 "Fluid Level"
+using N2kPGN127505 =
+    N2kPgnLayout<127505L, 6,
+                 N2kUIntField<4>,                         // Instance
+                 N2kUIntField<4>,                         // Fluid type
+                 N2kField<2, true, std::ratio<1, 250>>,   // Level, %
+                 N2kField<4, false, std::ratio<1, 10>>,   // Capacity, l
+                 N2kReservedField<8>>;
+
+/// PGN 127506 "DC Detailed Status"
+using N2kPGN127506 =
+    N2kPgnLayout<127506L, 6,
+                 N2kUIntField<8>,                          // SID
+                 N2kUIntField<8>,                          // DC instance
+                 N2kUIntField<8>,                          // DC type
+                 N2kUIntField<8>,                          // State of charge, %
+                 N2kUIntField<8>,                          // State of health, %
+                 N2kField<2, false, std::ratio<60>>,       // Time remaining, s
+                 N2kField<2, false, std::ratio<1, 1000>>,  // Ripple voltage, V
+                 N2kField<2, false, std::ratio<3600>>>;    // Capacity, C
+
+/// PGN 127507 "Charger Status"
+using N2kPGN127507 =
+    N2kPgnLayout<127507L, 6,
+                 N2kUIntField<8>,  // Charger instance
+                 N2kUIntField<8>,  // Battery instance
+                 N2kUIntField<4>,  // Charge state
+                 N2kUIntField<4>,  // Charger mode
+                 N2kUIntField<2>,  // Enabled
+                 N2kUIntField<2>,  // Equalization pending
+                 N2kReservedField<4>,
+                 N2kField<2, false, std::ratio<60>>>;  // Equalization time, s
+
+/// PGN 127508 "Battery Status"
+using N2kPGN127508 =
+    N2kPgnLayout<127508L, 6,
+                 N2kUIntField<8>,                         // Battery instance
+                 N2kField<2, true, std::ratio<1, 100>>,   // Voltage, V
+                 N2kField<2, true, std::ratio<1, 10>>,    // Current, A
+                 N2kField<2, false, std::ratio<1, 100>>,  // Temperature, K
+                 N2kUIntField<8>>;                        // SID
+
+static_assert(N2kBytesEqual(N2kPGN127488::Encode(0, 1500.0f, kN2kFloatNA,
+                                                 0x7f),
+                            {0x00, 0x70, 0x17, 0xff, 0xff, 0x7f, 0xff, 0xff}),
+              "PGN 127488 layout mismatch");
+static_assert(N2kBytesEqual(N2kPGN127505::Encode(1, 0, 50.0f, 200.0f),
+                            {0x01, 0xd4, 0x30, 0xd0, 0x07, 0x00, 0x00, 0xff}),
+              "PGN 127505 layout mismatch");
+static_assert(N2kBytesEqual(N2kPGN127506::Encode(0xff, 1, 0, 80, 95, 7200.0f,
+                                                 0.05f, 360000.0f),
+                            {0xff, 0x01, 0x00, 0x50, 0x5f, 0x78, 0x00, 0x32,
+                             0x00, 0x64, 0x00}),
+              "PGN 127506 layout mismatch");
+static_assert(N2kBytesEqual(N2kPGN127507::Encode(1, 2, 3, 0, 1, 0, 600.0f),
+                            {0x01, 0x02, 0x03, 0xf1, 0x0a, 0x00}),
+              "PGN 127507 layout mismatch");
+static_assert(N2kBytesEqual(N2kPGN127508::Encode(0, 12.8f, -5.0f, 298.15f,
+                                                 0xff),
+                            {0x00, 0x00, 0x05, 0xce, 0xff, 0x77, 0x74, 0xff}),
+              "PGN 127508 layout mismatch");
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_N2K_STANDARD_LAYOUTS_H_
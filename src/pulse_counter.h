@@ -0,0 +1,167 @@
+#ifndef HALMET_SRC_PULSE_COUNTER_H_
+#define HALMET_SRC_PULSE_COUNTER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace halmet {
+
+/// State of a pulse counter at one point in time.
+struct PulseSnapshot {
+  uint32_t count = 0;         // Total edges; wraps around
+  uint32_t newest_us = 0;     // Time of the newest edge
+  uint32_t reference_us = 0;  // Time of the edge `periods` edges earlier
+  int periods = 0;            // 0 if edge times are not available
+};
+
+/**
+ * @brief Source of counted input pulses.
+ *
+ * Implementations either timestamp individual edges, which allows period
+ * measurement, or only count them in hardware at no CPU cost, in which case
+ * the frequency is derived from the counts alone.
+ */
+class PulseCounter {
+ public:
+  virtual ~PulseCounter() {}
+
+  /**
+   * @brief Read the counter.
+   *
+   * @param max_periods Maximum number of periods to report timestamps for
+   */
+  virtual PulseSnapshot read(int max_periods) = 0;
+
+  /**
+   * @brief Ignore edges closer than the given time to the previous one.
+   *
+   * Counters that can't blank, e.g. hardware counters, ignore this.
+   */
+  virtual void set_blanking_time(uint32_t blanking_us) {}
+};
+
+/**
+ * @brief Frequency from pulse counter snapshots taken at regular intervals.
+ *
+ * Uses whole periods only:
+ *
+ * - If the counter has edge times and at most N edges arrived since the
+ *   previous snapshot, the last N periods are averaged, even if they span
+ *   several intervals.
+ * - Otherwise, all edges since the previous snapshot are used (reciprocal
+ *   counting).
+ *
+ * When the pulses stop, the open period is included once it is overdue, so
+ * the frequency falls off smoothly. It drops to zero after the timeout.
+ */
+class PulseFrequencyEstimator {
+ public:
+  void set_averaged_periods(int periods) {
+    averaged_periods_ = std::max(periods, 1);
+  }
+  int get_averaged_periods() const { return averaged_periods_; }
+
+  void set_timeout(uint32_t timeout_us) { timeout_us_ = timeout_us; }
+
+  float update(const PulseSnapshot& snapshot, uint32_t now_us) {
+    uint32_t new_edges = snapshot.count - last_count_;
+    last_count_ = snapshot.count;
+
+    if (new_edges > 0) {
+      bool counting =
+          snapshot.periods == 0 || new_edges > (uint32_t)averaged_periods_;
+      if (counting && newest_valid_) {
+        // All edges since the newest one of the previous snapshot
+        periods_ = new_edges;
+        span_us_ = snapshot.newest_us - newest_us_;
+      } else if (snapshot.periods > 0) {
+        periods_ = snapshot.periods;
+        span_us_ = snapshot.newest_us - snapshot.reference_us;
+      }
+      newest_us_ = snapshot.newest_us;
+      newest_valid_ = true;
+    }
+
+    uint32_t since_last_edge = now_us - newest_us_;
+    if (!newest_valid_ || periods_ == 0 || span_us_ == 0 ||
+        since_last_edge >= timeout_us_) {
+      return 0;
+    }
+
+    float span = span_us_;
+    // A period running half again as long as the average means the pulses
+    // are slowing down or have stopped.
+    float overdue = since_last_edge - 1.5f * span / periods_;
+    if (overdue > 0) {
+      span += overdue;
+    }
+    return periods_ * 1e6f / span;
+  }
+
+ protected:
+  int averaged_periods_ = 8;
+  uint32_t timeout_us_ = 2000000;
+
+  uint32_t last_count_ = 0;
+  uint32_t newest_us_ = 0;
+  bool newest_valid_ = false;
+  uint32_t periods_ = 0;
+  uint32_t span_us_ = 0;
+};
+
+/**
+ * @brief Pulse counter generating an ideal pulse train, for host builds and
+ * tests.
+ *
+ * Time is advanced explicitly with advance_to(). Frequency changes take
+ * effect at the current time, without losing the phase.
+ */
+class SimulatedPulseCounter : public PulseCounter {
+ public:
+  explicit SimulatedPulseCounter(float frequency = 0)
+      : frequency_{frequency} {}
+
+  void set_frequency(float frequency) { frequency_ = frequency; }
+
+  void advance_to(uint32_t now_us) {
+    uint32_t elapsed = now_us - now_us_;
+    now_us_ = now_us;
+    if (frequency_ <= 0) {
+      return;
+    }
+    double period = 1e6 / frequency_;
+    phase_us_ += elapsed;
+    uint32_t edges = (uint32_t)(phase_us_ / period);
+    if (edges > 0) {
+      count_ += edges;
+      phase_us_ -= edges * period;
+      newest_us_ = now_us_ - (uint32_t)phase_us_;
+      period_us_ = period;
+    }
+  }
+
+  PulseSnapshot read(int max_periods) override {
+    PulseSnapshot snapshot;
+    snapshot.count = count_;
+    snapshot.newest_us = newest_us_;
+    if (count_ > 1 && max_periods > 0) {
+      snapshot.periods = (int)std::min<uint32_t>(count_ - 1, max_periods);
+      snapshot.reference_us =
+          newest_us_ - (uint32_t)lround(snapshot.periods * period_us_);
+    }
+    return snapshot;
+  }
+
+ protected:
+  float frequency_;
+  uint32_t now_us_ = 0;
+  double phase_us_ = 0;
+  uint32_t count_ = 0;
+  uint32_t newest_us_ = 0;
+  double period_us_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_PULSE_COUNTER_H_
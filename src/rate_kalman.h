@@ -0,0 +1,187 @@
+#ifndef HALMET_SRC_RATE_KALMAN_H_
+#define HALMET_SRC_RATE_KALMAN_H_
+
+#include <cmath>
+
+namespace halmet {
+
+/**
+ * @brief Kalman filter estimating a level and its rate of change.
+ *
+ * Constant-velocity model: the state is the level and its rate, and the
+ * rate performs a random walk with the given spectral density. Each update
+ * costs a handful of float operations and no memory beyond the 2x2
+ * covariance.
+ *
+ * Units are up to the caller, as long as they are consistent: with levels
+ * in liters and time in hours, the rate is in liters per hour and
+ * rate_noise in (l/h)^2 per hour.
+ */
+class RateKalmanFilter {
+ public:
+  /**
+   * @param level_noise Standard deviation of the level measurements
+   * @param rate_noise Random walk spectral density of the rate
+   */
+  void configure(float level_noise, float rate_noise) {
+    r_ = level_noise * level_noise;
+    q_ = rate_noise;
+  }
+
+  void reset() { primed_ = false; }
+
+  /// Restart the level estimate from a measurement, keeping the rate.
+  void reset_level(float level) {
+    x_ = level;
+    p_xx_ = r_;
+    p_xv_ = 0;
+  }
+
+  /// Force the rate to a known value, e.g. zero while the engine is off.
+  void pin_rate(float rate) {
+    v_ = rate;
+    p_xv_ = 0;
+    p_vv_ = 0;
+  }
+
+  /**
+   * @brief Incorporate a measurement.
+   *
+   * Same as predict(), then correct(), except that the first call only
+   * initializes the level.
+   *
+   * @param level Measured level
+   * @param dt Time since the previous measurement
+   * @return Normalized innovation of the measurement, see innovation()
+   */
+  float update(float level, float dt) {
+    if (!primed_) {
+      x_ = level;
+      v_ = 0;
+      p_xx_ = r_;
+      p_xv_ = 0;
+      p_vv_ = 0;
+      primed_ = true;
+      return 0;
+    }
+
+    predict(dt);
+    float normalized_innovation = innovation(level);
+    correct(level);
+    return normalized_innovation;
+  }
+
+  /// Advance the state by dt. Only valid once primed.
+  void predict(float dt) {
+    x_ += v_ * dt;
+    float dt2 = dt * dt;
+    p_xx_ += dt * (2 * p_xv_ + dt * p_vv_) + q_ * dt2 * dt / 3;
+    p_xv_ += dt * p_vv_ + q_ * dt2 / 2;
+    p_vv_ += q_ * dt;
+  }
+
+  /**
+   * @brief Normalized innovation of a measurement against the prediction.
+   *
+   * How many standard deviations the measurement is from the predicted
+   * level. Check it before correct() to detect jumps such as refueling:
+   * correcting with a jump would also pull the rate towards it.
+   */
+  float innovation(float level) const {
+    return (level - x_) / sqrtf(p_xx_ + r_);
+  }
+
+  /// Correct the predicted state with a measurement.
+  void correct(float level) {
+    float innovation = level - x_;
+    float s = p_xx_ + r_;
+    float k_x = p_xx_ / s;
+    float k_v = p_xv_ / s;
+    x_ += k_x * innovation;
+    v_ += k_v * innovation;
+    p_vv_ -= k_v * p_xv_;
+    p_xv_ -= k_v * p_xx_;
+    p_xx_ -= k_x * p_xx_;
+  }
+
+  bool is_primed() const { return primed_; }
+  float get_level() const { return x_; }
+  float get_rate() const { return v_; }
+  /// Standard deviation of the rate estimate
+  float get_rate_stddev() const { return sqrtf(p_vv_); }
+
+ protected:
+  float r_ = 1;
+  float q_ = 1;
+  float x_ = 0;
+  float v_ = 0;
+  float p_xx_ = 0;
+  float p_xv_ = 0;
+  float p_vv_ = 0;
+  bool primed_ = false;
+};
+
+/**
+ * @brief Consumption rate of a tank that is refilled now and then.
+ *
+ * Runs each level measurement through a RateKalmanFilter. A level jump of
+ * more than refuel_threshold standard deviations above the prediction is
+ * taken as refilling: the level estimate restarts from the measurement and
+ * the rate is left alone. The consumption is the negated rate, clamped at
+ * zero.
+ */
+class ConsumptionRateFilter {
+ public:
+  /**
+   * @param level_noise Standard deviation of the level measurements
+   * @param rate_noise Random walk spectral density of the rate
+   * @param refuel_threshold Innovation treated as refilling, in standard
+   *   deviations
+   */
+  void configure(float level_noise, float rate_noise,
+                 float refuel_threshold) {
+    filter_.configure(level_noise, rate_noise);
+    refuel_threshold_ = refuel_threshold;
+  }
+
+  /// Force the rate to a known value, e.g. zero while the engine is off.
+  void pin_rate(float rate) { filter_.pin_rate(rate); }
+
+  /**
+   * @brief Incorporate a level measurement.
+   *
+   * @param level Measured level
+   * @param dt Time since the previous measurement
+   * @return Consumption rate, never negative
+   */
+  float update(float level, float dt) {
+    if (!filter_.is_primed()) {
+      filter_.update(level, dt);
+    } else {
+      filter_.predict(dt);
+      if (filter_.innovation(level) > refuel_threshold_) {
+        // The level jump says nothing about consumption, so restart the
+        // level without letting it correct the rate.
+        filter_.reset_level(level);
+        refuel_count_++;
+      } else {
+        filter_.correct(level);
+      }
+    }
+    float consumption = -filter_.get_rate();
+    return consumption > 0 ? consumption : 0;
+  }
+
+  /// Number of refills detected
+  unsigned long get_refuel_count() const { return refuel_count_; }
+  const RateKalmanFilter& get_filter() const { return filter_; }
+
+ protected:
+  RateKalmanFilter filter_;
+  float refuel_threshold_ = 10;
+  unsigned long refuel_count_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_RATE_KALMAN_H_
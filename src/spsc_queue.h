@@ -0,0 +1,65 @@
+#ifndef HALMET_SRC_SPSC_QUEUE_H_
+#define HALMET_SRC_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace halmet {
+
+/**
+ * @brief Lock-free single-producer, single-consumer ring buffer.
+ *
+ * Used to hand data from a FreeRTOS task to the event loop without taking
+ * a lock on either side. Exactly one task may push and exactly one task may
+ * pop.
+ *
+ * @tparam T Element type
+ * @tparam Size Capacity; must be a power of two
+ */
+template <typename T, size_t Size>
+class SpscQueue {
+  static_assert(Size > 0 && (Size & (Size - 1)) == 0,
+                "SpscQueue size must be a power of two");
+
+ public:
+  bool push(T item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == Size) {
+      dropped_++;
+      return false;
+    }
+    buffer_[head & (Size - 1)] = std::move(item);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (head_.load(std::memory_order_acquire) == tail) {
+      return false;
+    }
+    item = std::move(buffer_[tail & (Size - 1)]);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  // Number of items rejected because the queue was full. Only the producer
+  // writes this.
+  unsigned long get_dropped() const { return dropped_; }
+
+ private:
+  T buffer_[Size];
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+  unsigned long dropped_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_SPSC_QUEUE_H_
@@ -0,0 +1,200 @@
+// Checks CompiledCurve against a reference interpolator and benchmarks it
+// against the linear search that sensesp::CurveInterpolator does per input.
+//
+// Run with `pio test -e native -f test_compiled_curve`.
+
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "compiled_curve.h"
+
+using namespace halmet;
+
+using Interpolation = CompiledCurve::Interpolation;
+
+// Exposes the grid to check how many segments a lookup has to search.
+class InspectableCurve : public CompiledCurve {
+ public:
+  size_t num_buckets() const { return buckets_.size() - 1; }
+
+  size_t max_segments_per_bucket() const {
+    size_t max_segments = 0;
+    for (size_t b = 0; b + 1 < buckets_.size(); b++) {
+      max_segments =
+          std::max(max_segments, (size_t)(buckets_[b + 1] - buckets_[b] + 1));
+    }
+    return max_segments;
+  }
+};
+
+/**
+ * Piecewise linear interpolation with the same linear search over the
+ * sample list as sensesp::CurveInterpolator::set().
+ */
+static float ReferenceLinear(const std::vector<float>& xs,
+                             const std::vector<float>& ys, float x) {
+  if (x <= xs.front()) {
+    return ys.front();
+  }
+  for (size_t k = 1; k < xs.size(); k++) {
+    if (x < xs[k]) {
+      float t = (x - xs[k - 1]) / (xs[k] - xs[k - 1]);
+      return ys[k - 1] + t * (ys[k] - ys[k - 1]);
+    }
+  }
+  return ys.back();
+}
+
+// 20 points: dense at the bottom of an irregular hull tank, one long
+// straight section at the top.
+static void IrregularCurve(std::vector<float>* xs, std::vector<float>* ys) {
+  xs->clear();
+  ys->clear();
+  for (int i = 0; i < 19; i++) {
+    xs->push_back(i);
+    ys->push_back(i * i * 0.5f);
+  }
+  xs->push_back(1000);
+  ys->push_back(1000);
+}
+
+static std::vector<float> RandomInputs(float min, float max, size_t n) {
+  std::mt19937 rng(34);
+  std::uniform_real_distribution<float> distribution(min, max);
+  std::vector<float> inputs(n);
+  for (float& x : inputs) {
+    x = distribution(rng);
+  }
+  return inputs;
+}
+
+void test_empty_and_single_point() {
+  CompiledCurve curve;
+  TEST_ASSERT_TRUE(curve.empty());
+  TEST_ASSERT_TRUE(std::isnan(curve.evaluate(1)));
+  curve.compile({5}, {42}, Interpolation::kLinear);
+  TEST_ASSERT_EQUAL_FLOAT(42, curve.evaluate(-100));
+  TEST_ASSERT_EQUAL_FLOAT(42, curve.evaluate(100));
+}
+
+void test_clamps_outside_range() {
+  CompiledCurve curve;
+  curve.compile({0, 10, 20}, {100, 50, 0}, Interpolation::kLinear);
+  TEST_ASSERT_EQUAL_FLOAT(100, curve.evaluate(-1));
+  TEST_ASSERT_EQUAL_FLOAT(0, curve.evaluate(21));
+  TEST_ASSERT_EQUAL_FLOAT(0, curve.evaluate(20));
+  TEST_ASSERT_TRUE(curve.evaluate(NAN) == 100);
+}
+
+void test_linear_matches_reference() {
+  std::vector<float> xs, ys;
+  IrregularCurve(&xs, &ys);
+  CompiledCurve curve;
+  curve.compile(xs, ys, Interpolation::kLinear);
+
+  for (float x : RandomInputs(-10, 1010, 100000)) {
+    float expected = ReferenceLinear(xs, ys, x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f * (1 + fabsf(expected)), expected,
+                             curve.evaluate(x));
+  }
+  // At and next to every point
+  for (float x : xs) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, ReferenceLinear(xs, ys, x),
+                             curve.evaluate(x));
+    float below = nextafterf(x, -INFINITY);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, ReferenceLinear(xs, ys, below),
+                             curve.evaluate(below));
+  }
+}
+
+void test_irregular_curve_lookup_is_bounded() {
+  std::vector<float> xs, ys;
+  IrregularCurve(&xs, &ys);
+  InspectableCurve curve;
+  curve.compile(xs, ys, Interpolation::kLinear);
+  printf("%zu cells, at most %zu segments per cell\n", curve.num_buckets(),
+         curve.max_segments_per_bucket());
+  TEST_ASSERT_LESS_OR_EQUAL(2, curve.max_segments_per_bucket());
+}
+
+void test_cubic_passes_through_points_and_stays_monotonic() {
+  std::vector<float> xs, ys;
+  IrregularCurve(&xs, &ys);
+  CompiledCurve curve;
+  curve.compile(xs, ys, Interpolation::kMonotonicCubic);
+
+  for (size_t k = 0; k < xs.size(); k++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, ys[k], curve.evaluate(xs[k]));
+  }
+  float previous = curve.evaluate(xs.front());
+  for (float x = xs.front(); x <= xs.back(); x += 0.01f) {
+    float y = curve.evaluate(x);
+    TEST_ASSERT_TRUE(y >= previous - 1e-3f);
+    previous = y;
+  }
+}
+
+void test_cubic_does_not_overshoot_flat_sections() {
+  CompiledCurve curve;
+  curve.compile({0, 1, 2, 3, 4}, {0, 0, 10, 10, 20},
+                Interpolation::kMonotonicCubic);
+  for (float x = 0; x <= 1; x += 0.01f) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0, curve.evaluate(x));
+  }
+  for (float x = 2; x <= 3; x += 0.01f) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 10, curve.evaluate(x));
+  }
+}
+
+template <typename F>
+static double NanosecondsPerCall(const std::vector<float>& inputs, F f) {
+  volatile float sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int repeat = 0; repeat < 20; repeat++) {
+    for (float x : inputs) {
+      sink = sink + f(x);
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         (20.0 * inputs.size());
+}
+
+void test_benchmark() {
+  std::vector<float> inputs = RandomInputs(0, 1000, 100000);
+  for (size_t n : {5, 20, 50, 200}) {
+    std::vector<float> xs, ys;
+    for (size_t k = 0; k < n; k++) {
+      xs.push_back(1000.0f * k / (n - 1));
+      ys.push_back(sqrtf(xs.back()));
+    }
+    CompiledCurve curve;
+    curve.compile(xs, ys, Interpolation::kLinear);
+    double reference = NanosecondsPerCall(
+        inputs, [&](float x) { return ReferenceLinear(xs, ys, x); });
+    double compiled =
+        NanosecondsPerCall(inputs, [&](float x) { return curve.evaluate(x); });
+    printf("%3zu points: linear search %6.1f ns, compiled %6.1f ns\n", n,
+           reference, compiled);
+  }
+  TEST_PASS();
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_and_single_point);
+  RUN_TEST(test_clamps_outside_range);
+  RUN_TEST(test_linear_matches_reference);
+  RUN_TEST(test_irregular_curve_lookup_is_bounded);
+  RUN_TEST(test_cubic_passes_through_points_and_stays_monotonic);
+  RUN_TEST(test_cubic_does_not_overshoot_flat_sections);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
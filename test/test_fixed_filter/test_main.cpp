@@ -0,0 +1,210 @@
+// Runs tank sender traces through the fixed-point filter chain used by
+// TankSenderFilter: running median, then EMA or second-order low-pass.
+//
+// The built-in trace models a sender in a sloshing tank: the resistance
+// swings +-15% around the true value at wave and roll frequencies, with
+// noise and contact bounce spikes. A recorded trace (one resistance value
+// per line, in ohms) can be run instead by pointing HALMET_SLOSH_TRACE at
+// it; HALMET_SLOSH_INTERVAL sets its sample interval in ms (default 100).
+//
+// Run with `pio test -e native -f test_fixed_filter`.
+
+#include <unity.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "fixed_filter.h"
+
+using namespace halmet;
+
+// Same chain as TankSenderFilter::set()
+template <typename Smoother>
+static std::vector<float> RunChain(const std::vector<float>& trace,
+                                   size_t median_window, Smoother& smoother) {
+  MedianFilter<15> median(median_window);
+  std::vector<float> output;
+  output.reserve(trace.size());
+  for (float sample : trace) {
+    int32_t value = median.update(FloatToFixedSample(sample));
+    output.push_back(FixedSampleToFloat(smoother.update(value)));
+  }
+  return output;
+}
+
+static void SwingAfter(const std::vector<float>& values, size_t start,
+                       float* min, float* max) {
+  *min = values[start];
+  *max = values[start];
+  for (size_t i = start; i < values.size(); i++) {
+    *min = std::min(*min, values[i]);
+    *max = std::max(*max, values[i]);
+  }
+}
+
+/**
+ * Synthetic slosh trace: a 120 ohm sender reading with a +-15% swing made
+ * of a 6 s wave and a 14 s roll component, 1% noise and occasional
+ * full-scale spikes from contact bounce.
+ */
+static std::vector<float> SloshTrace(float true_value, float sample_interval,
+                                     float duration) {
+  std::mt19937 rng(33);
+  std::normal_distribution<float> noise(0, true_value * 0.01f);
+  std::uniform_real_distribution<float> uniform(0, 1);
+  std::vector<float> trace;
+  for (float t = 0; t < duration; t += sample_interval) {
+    float slosh = 0.10f * sinf(2 * M_PI * t / 6.0f) +
+                  0.05f * sinf(2 * M_PI * t / 14.0f + 1.0f);
+    float value = true_value * (1 + slosh) + noise(rng);
+    if (uniform(rng) < 0.01f) {
+      value = uniform(rng) < 0.5f ? 0 : 300;
+    }
+    trace.push_back(value);
+  }
+  return trace;
+}
+
+void test_sample_conversion() {
+  TEST_ASSERT_EQUAL_INT32(256 * 190, FloatToFixedSample(190));
+  TEST_ASSERT_EQUAL_FLOAT(12.5f, FixedSampleToFloat(FloatToFixedSample(12.5f)));
+  TEST_ASSERT_EQUAL_FLOAT(-3.25f,
+                          FixedSampleToFloat(FloatToFixedSample(-3.25f)));
+}
+
+void test_median_removes_spikes() {
+  MedianFilter<15> median(5);
+  for (int i = 0; i < 5; i++) {
+    median.update(100);
+  }
+  TEST_ASSERT_EQUAL_INT32(100, median.update(10000));
+  TEST_ASSERT_EQUAL_INT32(100, median.update(100));
+  TEST_ASSERT_EQUAL_INT32(100, median.update(-10000));
+  TEST_ASSERT_EQUAL_INT32(100, median.update(100));
+}
+
+void test_median_window_is_clamped() {
+  MedianFilter<15> median(100);
+  TEST_ASSERT_EQUAL_UINT32(15, median.get_size());
+  median.set_size(0);
+  TEST_ASSERT_EQUAL_UINT32(1, median.get_size());
+  // A window of one passes everything through
+  TEST_ASSERT_EQUAL_INT32(7, median.update(7));
+  TEST_ASSERT_EQUAL_INT32(-7, median.update(-7));
+}
+
+void test_ema_step_response() {
+  FixedEmaFilter ema;
+  ema.configure(10, 0.1f);
+  TEST_ASSERT_EQUAL_INT32(0, ema.update(0));
+  int32_t value = 0;
+  // One time constant: 1 - 1/e of the step
+  for (int i = 0; i < 100; i++) {
+    value = ema.update(256000);
+  }
+  TEST_ASSERT_INT32_WITHIN(256000 / 100, 256000 * (1 - expf(-1)), value);
+  for (int i = 0; i < 2000; i++) {
+    value = ema.update(256000);
+  }
+  TEST_ASSERT_INT32_WITHIN(1, 256000, value);
+}
+
+void test_low_pass_has_unity_dc_gain() {
+  FixedBiquadLowPass low_pass;
+  // Very low cutoff relative to the sample rate, as used for tanks
+  low_pass.configure(0.001f, 100);
+  low_pass.update(0);
+  int32_t value = 0;
+  for (int i = 0; i < 2000000; i++) {
+    value = low_pass.update(48640);
+  }
+  TEST_ASSERT_EQUAL_INT32(48640, value);
+}
+
+void test_low_pass_starts_in_steady_state() {
+  FixedBiquadLowPass low_pass;
+  low_pass.configure(0.01f, 10);
+  for (int i = 0; i < 100; i++) {
+    TEST_ASSERT_EQUAL_INT32(30720, low_pass.update(30720));
+  }
+}
+
+void test_slosh_trace_low_pass() {
+  const float kTrueValue = 120;
+  std::vector<float> trace = SloshTrace(kTrueValue, 0.1f, 600);
+  FixedBiquadLowPass low_pass;
+  // TankSenderFilter defaults: median of 5, 20 s time constant
+  low_pass.configure(1 / (2 * M_PI * 20), 10);
+  std::vector<float> output = RunChain(trace, 5, low_pass);
+
+  float min, max;
+  SwingAfter(trace, 0, &min, &max);
+  printf("raw: %.1f .. %.1f ohm\n", min, max);
+  // Skip the first 2 minutes while the filter settles from the first sample
+  SwingAfter(output, 1200, &min, &max);
+  printf("low-pass: %.2f .. %.2f ohm\n", min, max);
+  TEST_ASSERT_FLOAT_WITHIN(kTrueValue * 0.015f, kTrueValue, min);
+  TEST_ASSERT_FLOAT_WITHIN(kTrueValue * 0.015f, kTrueValue, max);
+}
+
+void test_slosh_trace_ema() {
+  const float kTrueValue = 120;
+  std::vector<float> trace = SloshTrace(kTrueValue, 0.1f, 600);
+  FixedEmaFilter ema;
+  ema.configure(20, 0.1f);
+  std::vector<float> output = RunChain(trace, 5, ema);
+
+  float min, max;
+  SwingAfter(output, 1200, &min, &max);
+  printf("EMA: %.2f .. %.2f ohm\n", min, max);
+  TEST_ASSERT_FLOAT_WITHIN(kTrueValue * 0.03f, kTrueValue, min);
+  TEST_ASSERT_FLOAT_WITHIN(kTrueValue * 0.03f, kTrueValue, max);
+}
+
+void test_recorded_trace() {
+  const char* path = getenv("HALMET_SLOSH_TRACE");
+  if (path == nullptr) {
+    TEST_IGNORE_MESSAGE("HALMET_SLOSH_TRACE not set");
+  }
+  std::ifstream file(path);
+  TEST_ASSERT_TRUE_MESSAGE(file.good(), "Cannot open HALMET_SLOSH_TRACE");
+  std::vector<float> trace;
+  float value;
+  while (file >> value) {
+    trace.push_back(value);
+  }
+  TEST_ASSERT_TRUE(trace.size() > 0);
+
+  const char* interval = getenv("HALMET_SLOSH_INTERVAL");
+  float sample_interval = (interval ? atoi(interval) : 100) / 1000.0f;
+  FixedBiquadLowPass low_pass;
+  low_pass.configure(1 / (2 * M_PI * 20), 1 / sample_interval);
+  std::vector<float> output = RunChain(trace, 5, low_pass);
+
+  float raw_min, raw_max, min, max;
+  SwingAfter(trace, 0, &raw_min, &raw_max);
+  SwingAfter(output, output.size() / 5, &min, &max);
+  printf("%zu samples, raw %.1f .. %.1f, filtered %.2f .. %.2f ohm\n",
+         trace.size(), raw_min, raw_max, min, max);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sample_conversion);
+  RUN_TEST(test_median_removes_spikes);
+  RUN_TEST(test_median_window_is_clamped);
+  RUN_TEST(test_ema_step_response);
+  RUN_TEST(test_low_pass_has_unity_dc_gain);
+  RUN_TEST(test_low_pass_starts_in_steady_state);
+  RUN_TEST(test_slosh_trace_low_pass);
+  RUN_TEST(test_slosh_trace_ema);
+  RUN_TEST(test_recorded_trace);
+  return UNITY_END();
+}
@@ -0,0 +1,273 @@
+// Checks that the fixed-point PGN encoders produce the same bytes as the
+// NMEA2000 library's double-precision builders.
+//
+// Run with `pio test -e native -f test_n2k_pgn_layout`.
+
+#include <Arduino.h>
+#include <N2kMessages.h>
+#include <unity.h>
+
+#include <random>
+
+#include "n2k_standard_layouts.h"
+
+using namespace halmet;
+
+// The library needs the Arduino timing functions on the host.
+extern "C" {
+uint32_t millis() { return 0; }
+uint32_t micros() { return 0; }
+void delay(uint32_t ms) {}
+}
+
+// Random inputs per field and PGN
+const int kIterations = 100000;
+
+static std::mt19937 rng(12345);
+
+static float RandomFloat(float min, float max) {
+  return std::uniform_real_distribution<float>(min, max)(rng);
+}
+
+static void AssertSameMessage(const tN2kMsg& expected, const tN2kMsg& actual) {
+  TEST_ASSERT_EQUAL_UINT32(expected.PGN, actual.PGN);
+  TEST_ASSERT_EQUAL_UINT8(expected.Priority, actual.Priority);
+  TEST_ASSERT_EQUAL_INT(expected.DataLen, actual.DataLen);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.Data, actual.Data, expected.DataLen);
+}
+
+/**
+ * Encode random values, N/A and out-of-range values with a layout field and
+ * with the library's Add*Double() method for the same field, and compare.
+ *
+ * The random values cover the field's data range and 10% past it on both
+ * sides, but not below the smallest data value of signed fields, where the
+ * out-of-range handling differs between library versions.
+ */
+template <typename Field>
+void CheckField(void (tN2kMsg::*add)(double, double, double),
+                double resolution) {
+  using Limits = typename Field::Limits;
+  float max = (float)Limits::kMax * (float)resolution;
+  float min = (float)Limits::kMin * (float)resolution;
+  float lo = min < 0 ? min : -0.1f * max;
+  float hi = 1.1f * max;
+
+  for (int i = 0; i < kIterations + 2; i++) {
+    float value = i == kIterations       ? kN2kFloatNA
+                  : i == kIterations + 1 ? 1.5f * max
+                                         : RandomFloat(lo, hi);
+    tN2kMsg expected;
+    (expected.*add)(value, resolution, N2kDoubleNA);
+    uint32_t raw = Field::encode(value);
+    for (int b = 0; b < expected.DataLen; b++) {
+      char message[64];
+      snprintf(message, sizeof(message), "value %.9g", value);
+      TEST_ASSERT_EQUAL_HEX8_MESSAGE(expected.Data[b], (raw >> (8 * b)) & 0xff,
+                                     message);
+    }
+  }
+}
+
+/**
+ * Same check for N2kScaledValue, which the senders use to convert their
+ * inputs at runtime resolutions instead of compile-time ratios.
+ */
+template <int Bytes, bool Signed>
+void CheckScaledValue(void (tN2kMsg::*add)(double, double, double),
+                      double resolution) {
+  using Limits = N2kFieldLimits<Bytes, Signed>;
+  N2kScaledValue<Bytes, Signed> scaled(resolution, 1000);
+  float max = (float)Limits::kMax * (float)resolution;
+  float min = (float)Limits::kMin * (float)resolution;
+  float lo = min < 0 ? min : -0.1f * max;
+  float hi = 1.1f * max;
+
+  for (int i = 0; i < kIterations + 2; i++) {
+    float value = i == kIterations       ? kN2kFloatNA
+                  : i == kIterations + 1 ? 1.5f * max
+                                         : RandomFloat(lo, hi);
+    tN2kMsg expected;
+    (expected.*add)(value, resolution, N2kDoubleNA);
+    uint32_t raw = scaled.scale(value);
+    for (int b = 0; b < expected.DataLen; b++) {
+      char message[64];
+      snprintf(message, sizeof(message), "value %.9g at %g", value,
+               resolution);
+      TEST_ASSERT_EQUAL_HEX8_MESSAGE(expected.Data[b], (raw >> (8 * b)) & 0xff,
+                                     message);
+    }
+  }
+}
+
+void test_unsigned_2_byte_fields() {
+  CheckField<N2kField<2, false, std::ratio<1, 4>>>(
+      &tN2kMsg::Add2ByteUDouble, 0.25);
+  CheckField<N2kField<2, false, std::ratio<1, 10>>>(
+      &tN2kMsg::Add2ByteUDouble, 0.1);
+  CheckField<N2kField<2, false, std::ratio<1, 100>>>(
+      &tN2kMsg::Add2ByteUDouble, 0.01);
+  CheckField<N2kField<2, false, std::ratio<100>>>(&tN2kMsg::Add2ByteUDouble,
+                                                  100);
+  CheckField<N2kField<2, false, std::ratio<1000>>>(&tN2kMsg::Add2ByteUDouble,
+                                                   1000);
+}
+
+void test_signed_2_byte_fields() {
+  CheckField<N2kField<2, true, std::ratio<1, 100>>>(&tN2kMsg::Add2ByteDouble,
+                                                    0.01);
+  CheckField<N2kField<2, true, std::ratio<1, 10>>>(&tN2kMsg::Add2ByteDouble,
+                                                   0.1);
+  CheckField<N2kField<2, true, std::ratio<1, 250>>>(&tN2kMsg::Add2ByteDouble,
+                                                    0.004);
+}
+
+void test_unsigned_4_byte_fields() {
+  CheckField<N2kField<4, false, std::ratio<1, 10>>>(
+      &tN2kMsg::Add4ByteUDouble, 0.1);
+}
+
+void test_scaled_values() {
+  for (double resolution : {0.001, 0.01, 0.1, 0.25, 60.0, 100.0, 1000.0,
+                            3600.0}) {
+    CheckScaledValue<2, false>(&tN2kMsg::Add2ByteUDouble, resolution);
+  }
+  for (double resolution : {0.004, 0.01, 0.1}) {
+    CheckScaledValue<2, true>(&tN2kMsg::Add2ByteDouble, resolution);
+  }
+}
+
+void test_pgn_127488() {
+  for (int i = 0; i < kIterations; i++) {
+    uint8_t instance = rng() % 254;
+    float speed = i % 10 == 0 ? kN2kFloatNA : RandomFloat(0, 8000);
+    float boost = i % 7 == 0 ? kN2kFloatNA : RandomFloat(0, 300000);
+    int8_t tilt = i % 5 == 0 ? N2kInt8NA : (int8_t)(rng() % 201 - 100);
+
+    tN2kMsg expected;
+    SetN2kEngineParamRapid(expected, instance, speed, boost, tilt);
+    tN2kMsg actual;
+    N2kPGN127488::Set(actual, instance, speed, boost, tilt);
+    AssertSameMessage(expected, actual);
+  }
+}
+
+void test_pgn_127489() {
+  for (int i = 0; i < kIterations; i++) {
+    uint8_t instance = rng() % 254;
+    float oil_pressure = RandomFloat(0, 1000000);
+    float oil_temperature = i % 3 == 0 ? kN2kFloatNA : RandomFloat(250, 450);
+    float temperature = RandomFloat(250, 400);
+    float alternator = RandomFloat(-5, 30);
+    float fuel_rate = i % 4 == 0 ? kN2kFloatNA : RandomFloat(-10, 200);
+    uint32_t hours = rng() % 100000000;
+    float coolant_pressure = RandomFloat(0, 500000);
+    float fuel_pressure = RandomFloat(0, 5000000);
+    int8_t load = (int8_t)(rng() % 101);
+    int8_t torque = i % 2 == 0 ? N2kInt8NA : (int8_t)(rng() % 101);
+    tN2kEngineDiscreteStatus1 status_1 = (uint16_t)rng();
+    tN2kEngineDiscreteStatus2 status_2 = (uint16_t)rng();
+
+    tN2kMsg expected;
+    SetN2kEngineDynamicParam(expected, instance, oil_pressure, oil_temperature,
+                             temperature, alternator, fuel_rate, hours,
+                             coolant_pressure, fuel_pressure, load, torque,
+                             status_1, status_2);
+    tN2kMsg actual;
+    N2kPGN127489::Set(actual, instance, oil_pressure, oil_temperature,
+                      temperature, alternator, fuel_rate, hours,
+                      coolant_pressure, fuel_pressure, status_1.Status,
+                      status_2.Status, load, torque);
+    AssertSameMessage(expected, actual);
+  }
+}
+
+void test_pgn_127505() {
+  for (int i = 0; i < kIterations; i++) {
+    uint8_t instance = rng() % 16;
+    tN2kFluidType type = (tN2kFluidType)(rng() % 7);
+    float level = i % 10 == 0 ? kN2kFloatNA : RandomFloat(-5, 105);
+    float capacity = RandomFloat(0, 100000);
+
+    tN2kMsg expected;
+    SetN2kFluidLevel(expected, instance, type, level, capacity);
+    tN2kMsg actual;
+    N2kPGN127505::Set(actual, instance, type, level, capacity);
+    AssertSameMessage(expected, actual);
+  }
+}
+
+void test_pgn_127506() {
+  for (int i = 0; i < kIterations; i++) {
+    uint8_t sid = rng() % 256;
+    uint8_t instance = rng() % 254;
+    tN2kDCType type = (tN2kDCType)(rng() % 5);
+    uint8_t soc = rng() % 101;
+    uint8_t soh = i % 3 == 0 ? 0xff : rng() % 101;
+    float time_remaining = i % 5 == 0 ? kN2kFloatNA : RandomFloat(0, 400000);
+    float ripple = i % 7 == 0 ? kN2kFloatNA : RandomFloat(0, 70);
+    float capacity = RandomFloat(0, 2.4e8);
+
+    tN2kMsg expected;
+    SetN2kDCStatus(expected, sid, instance, type, soc, soh, time_remaining,
+                   ripple, capacity);
+    tN2kMsg actual;
+    N2kPGN127506::Set(actual, sid, instance, type, soc, soh, time_remaining,
+                      ripple, capacity);
+    AssertSameMessage(expected, actual);
+  }
+}
+
+void test_pgn_127507() {
+  for (int i = 0; i < kIterations; i++) {
+    uint8_t charger = rng() % 254;
+    uint8_t battery = rng() % 254;
+    tN2kChargeState state = (tN2kChargeState)(rng() % 16);
+    tN2kChargerMode mode = (tN2kChargerMode)(rng() % 16);
+    tN2kOnOff enabled = (tN2kOnOff)(rng() % 4);
+    tN2kOnOff pending = (tN2kOnOff)(rng() % 4);
+    float time = i % 5 == 0 ? kN2kFloatNA : RandomFloat(0, 400000);
+
+    tN2kMsg expected;
+    SetN2kChargerStatus(expected, charger, battery, state, mode, enabled,
+                        pending, time);
+    tN2kMsg actual;
+    N2kPGN127507::Set(actual, charger, battery, state, mode, enabled, pending,
+                      time);
+    AssertSameMessage(expected, actual);
+  }
+}
+
+void test_pgn_127508() {
+  for (int i = 0; i < kIterations; i++) {
+    uint8_t instance = rng() % 254;
+    float voltage = RandomFloat(-5, 60);
+    float current = i % 4 == 0 ? kN2kFloatNA : RandomFloat(-500, 500);
+    float temperature = i % 3 == 0 ? kN2kFloatNA : RandomFloat(230, 350);
+    uint8_t sid = rng() % 256;
+
+    tN2kMsg expected;
+    SetN2kDCBatStatus(expected, instance, voltage, current, temperature, sid);
+    tN2kMsg actual;
+    N2kPGN127508::Set(actual, instance, voltage, current, temperature, sid);
+    AssertSameMessage(expected, actual);
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_unsigned_2_byte_fields);
+  RUN_TEST(test_signed_2_byte_fields);
+  RUN_TEST(test_unsigned_4_byte_fields);
+  RUN_TEST(test_scaled_values);
+  RUN_TEST(test_pgn_127488);
+  RUN_TEST(test_pgn_127489);
+  RUN_TEST(test_pgn_127505);
+  RUN_TEST(test_pgn_127506);
+  RUN_TEST(test_pgn_127507);
+  RUN_TEST(test_pgn_127508);
+  return UNITY_END();
+}
@@ -0,0 +1,214 @@
+// Runs tank volume traces through ConsumptionRateFilter with the same
+// settings as FuelRateEstimator.
+//
+// The trip trace is synthetic: a tank volume sampled once per second, as
+// TankSenderFilter emits it, with the filtered sender noise and a slow
+// residual slosh on top of a known consumption profile. A recorded trace
+// can be run instead by pointing HALMET_TRIP_TRACE at a file with one
+// "seconds liters" pair per line.
+//
+// Run with `pio test -e native -f test_rate_kalman`.
+
+#include <unity.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "rate_kalman.h"
+
+using namespace halmet;
+
+// FuelRateEstimator defaults
+const float kVolumeNoise = 0.5;     // l
+const float kRateNoise = 2;         // l/h/min
+const float kRefuelThreshold = 10;  // standard deviations
+
+const float kSecondsPerHour = 3600;
+
+struct TripSample {
+  float time;          // s
+  float volume;        // l, as measured
+  float consumption;   // l/h, true value; unused for recorded traces
+};
+
+// Configured like FuelRateEstimator
+class Estimator : public ConsumptionRateFilter {
+ public:
+  Estimator() {
+    configure(kVolumeNoise, kRateNoise * kRateNoise * 60, kRefuelThreshold);
+  }
+};
+
+/**
+ * Two hour trip: 10 min idle at 2 l/h, 40 min cruise at 20 l/h, 20 min at
+ * 35 l/h, a 100 l refuel while idling at the fuel dock, then 45 min at
+ * 20 l/h.
+ */
+static std::vector<TripSample> TripTrace() {
+  std::mt19937 rng(35);
+  std::normal_distribution<float> noise(0, kVolumeNoise);
+  std::vector<TripSample> trace;
+  float volume = 300;
+  for (int t = 0; t < 7200; t++) {
+    float minute = t / 60.0f;
+    float consumption = minute < 10    ? 2
+                        : minute < 50  ? 20
+                        : minute < 70  ? 35
+                        : minute < 75  ? 2
+                                       : 20;
+    if (t == 72 * 60) {
+      volume += 100;
+    }
+    volume -= consumption / kSecondsPerHour;
+    float slosh = 0.3f * sinf(2 * M_PI * t / 90.0f);
+    trace.push_back({(float)t, volume + slosh + noise(rng), consumption});
+  }
+  return trace;
+}
+
+void test_rate_converges_on_steady_burn() {
+  RateKalmanFilter filter;
+  filter.configure(kVolumeNoise, kRateNoise * kRateNoise * 60);
+  std::mt19937 rng(1);
+  std::normal_distribution<float> noise(0, kVolumeNoise);
+  float dt = 1 / kSecondsPerHour;
+  for (int t = 0; t < 1800; t++) {
+    filter.update(200 - 20 * t * dt + noise(rng), dt);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(2, -20, filter.get_rate());
+}
+
+void test_refuel_keeps_rate() {
+  Estimator estimator;
+  std::mt19937 rng(2);
+  std::normal_distribution<float> noise(0, kVolumeNoise);
+  float dt = 1 / kSecondsPerHour;
+  float volume = 200;
+  float consumption = 0;
+  for (int t = 0; t < 3600; t++) {
+    if (t == 1800) {
+      volume += 100;
+    }
+    volume -= 20 * dt;
+    consumption = estimator.update(volume + noise(rng), dt);
+    if (t >= 1800 && t < 1900) {
+      // Right after the refuel the estimate must not jump
+      TEST_ASSERT_FLOAT_WITHIN(4, 20, consumption);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(1, estimator.get_refuel_count());
+  TEST_ASSERT_FLOAT_WITHIN(2, 20, consumption);
+}
+
+void test_pinned_rate_holds_while_stopped() {
+  RateKalmanFilter filter;
+  filter.configure(kVolumeNoise, kRateNoise * kRateNoise * 60);
+  std::mt19937 rng(3);
+  std::normal_distribution<float> noise(0, kVolumeNoise);
+  float dt = 1 / kSecondsPerHour;
+  for (int t = 0; t < 600; t++) {
+    filter.pin_rate(0);
+    filter.update(150 + noise(rng), dt);
+  }
+  // Each measurement still nudges the rate a little after pinning; the
+  // estimator reports zero while stopped anyway.
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 0, filter.get_rate());
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 150, filter.get_level());
+}
+
+/**
+ * Compare the estimate with the true consumption once it has been steady
+ * for 10 minutes; the filter needs a few minutes to follow a throttle
+ * change. Also integrate both over the whole trip.
+ */
+static void RunTrip(const std::vector<TripSample>& trace, int* refuels,
+                    float* bias, float* rms_error, float* burned,
+                    float* estimated_burned) {
+  Estimator estimator;
+  double error_sum = 0;
+  double squared_error = 0;
+  int compared = 0;
+  *burned = 0;
+  *estimated_burned = 0;
+  float last_time = trace.front().time;
+  float last_consumption = trace.front().consumption;
+  float steady_since = trace.front().time;
+  for (const TripSample& sample : trace) {
+    float dt = (sample.time - last_time) / kSecondsPerHour;
+    last_time = sample.time;
+    float estimate = estimator.update(sample.volume, dt);
+    *burned += sample.consumption * dt;
+    *estimated_burned += estimate * dt;
+    if (sample.consumption != last_consumption) {
+      last_consumption = sample.consumption;
+      steady_since = sample.time;
+    }
+    if (sample.time - steady_since >= 600) {
+      float error = estimate - sample.consumption;
+      error_sum += error;
+      squared_error += error * error;
+      compared++;
+    }
+  }
+  *refuels = estimator.get_refuel_count();
+  *bias = error_sum / compared;
+  *rms_error = sqrt(squared_error / compared);
+}
+
+void test_trip_trace() {
+  int refuels;
+  float bias, rms_error, burned, estimated_burned;
+  RunTrip(TripTrace(), &refuels, &bias, &rms_error, &burned,
+          &estimated_burned);
+  printf("refuels %d, steady bias %.2f l/h, rms error %.2f l/h\n", refuels,
+         bias, rms_error);
+  printf("burned %.1f l, estimated %.1f l\n", burned, estimated_burned);
+  TEST_ASSERT_EQUAL_INT(1, refuels);
+  TEST_ASSERT_FLOAT_WITHIN(1, 0, bias);
+  TEST_ASSERT_LESS_THAN(3, rms_error);
+  TEST_ASSERT_FLOAT_WITHIN(burned * 0.05f, burned, estimated_burned);
+}
+
+void test_recorded_trip() {
+  const char* path = getenv("HALMET_TRIP_TRACE");
+  if (path == nullptr) {
+    TEST_IGNORE_MESSAGE("HALMET_TRIP_TRACE not set");
+  }
+  std::ifstream file(path);
+  TEST_ASSERT_TRUE_MESSAGE(file.good(), "Cannot open HALMET_TRIP_TRACE");
+  std::vector<TripSample> trace;
+  float time, volume;
+  while (file >> time >> volume) {
+    trace.push_back({time, volume, 0});
+  }
+  TEST_ASSERT_TRUE(trace.size() > 1);
+
+  Estimator estimator;
+  float last_time = trace.front().time;
+  float estimate = 0;
+  for (const TripSample& sample : trace) {
+    estimate = estimator.update(sample.volume,
+                                (sample.time - last_time) / kSecondsPerHour);
+    last_time = sample.time;
+  }
+  float hours = (trace.back().time - trace.front().time) / kSecondsPerHour;
+  printf("%zu samples over %.2f h, %lu refuels, final estimate %.2f l/h\n",
+         trace.size(), hours, estimator.get_refuel_count(), estimate);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_rate_converges_on_steady_burn);
+  RUN_TEST(test_refuel_keeps_rate);
+  RUN_TEST(test_pinned_rate_holds_while_stopped);
+  RUN_TEST(test_trip_trace);
+  RUN_TEST(test_recorded_trip);
+  return UNITY_END();
+}